@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2026 saybur
+ *
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this
+ * program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "adouble.h"
+#include "util.h"
+
+/*
+ * This compilation unit reads AppleDouble headers. When macOS (or netatalk, or
+ * Samba with the right options) copies a file to a filesystem without forks it
+ * writes the data fork as "name" and everything else as "._name": a small header
+ * listing numbered entries, each an offset and length within the sidecar file. Only
+ * the resource fork, Finder info, and dates entries are of interest here.
+ */
+
+#define AD_MAGIC      0x00051607L
+#define AD_HEAD_SIZE  26
+#define AD_ENTRY_SIZE 12
+
+#define AD_ID_RSRC    2
+#define AD_ID_DATES   8
+#define AD_ID_FINDER  9
+
+/* AppleDouble dates are seconds from 2000, Mac dates are seconds from 1904 */
+#define AD_EPOCH      3029529600UL
+
+/**
+ * Checks if a name is that of an AppleDouble sidecar, which is "._" followed by the
+ * name of the file it belongs to.
+ *
+ * @param name  the Pascal name to check.
+ * @return      true if the name has the sidecar prefix.
+ */
+Boolean adouble_is_sidecar(unsigned char *name)
+{
+	return name[0] > 2 && name[1] == '.' && name[2] == '_';
+}
+
+/**
+ * Parses the header of an AppleDouble sidecar, updating the information for the file
+ * it belongs to. The type, creator, Finder flags, and dates are only changed if the
+ * sidecar has them, and only if they are within the data given; in practice they
+ * always directly follow the header.
+ *
+ * AppleDouble dates are GMT, and are used as-is without correcting for time zone.
+ *
+ * @param buf     the start of the sidecar.
+ * @param len     the length of the data given.
+ * @param info    information for the file, updated from the sidecar.
+ * @param rstart  set to the offset of the resource fork within the sidecar. The
+ *                resource fork length is set in the info, or zero if there is none.
+ * @return        true if this was an AppleDouble header, false otherwise.
+ */
+Boolean adouble_parse(unsigned char *buf, long len, ForkInfo *info, long *rstart)
+{
+	short i, count;
+	long id, offset, length;
+	unsigned char *e, *p;
+
+	*rstart = 0;
+	info->rlen = 0;
+
+	if (len < AD_HEAD_SIZE || be32(buf) != AD_MAGIC) return false;
+	count = be16(&(buf[24]));
+	if (count < 0 || AD_HEAD_SIZE + (long) count * AD_ENTRY_SIZE > len) return false;
+
+	for (i = 0; i < count; i++) {
+		e = &(buf[AD_HEAD_SIZE + i * AD_ENTRY_SIZE]);
+		id = be32(e);
+		offset = be32(&(e[4]));
+		length = be32(&(e[8]));
+		if (offset < 0 || length < 0) continue;
+		p = &(buf[offset]);
+
+		if (id == AD_ID_RSRC) {
+			*rstart = offset;
+			info->rlen = length;
+		} else if (id == AD_ID_FINDER && length >= 10 && offset + 10 <= len) {
+			info->type = be32(p);
+			info->creator = be32(&(p[4]));
+			info->flags = be16(&(p[8]));
+			info->set_info = true;
+		} else if (id == AD_ID_DATES && length >= 8 && offset + 8 <= len) {
+			info->crdate = be32(p) + AD_EPOCH;
+			info->mddate = be32(&(p[4])) + AD_EPOCH;
+			info->set_info = true;
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,344 @@
+/*
+ * Copyright (C) 2026 saybur
+ *
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this
+ * program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "binhex.h"
+#include "crc.h"
+#include "util.h"
+
+/*
+ * This compilation unit decodes BinHex 4.0 a piece at a time, so files can be
+ * decoded as they arrive instead of in a separate pass afterwards.
+ *
+ * BinHex is three layers deep. The text between the first and last ':' is 6 bits per
+ * character, ignoring line breaks. Those bytes are run-length encoded, where 0x90 is
+ * followed by a count for the byte before it, or a zero for a literal 0x90. What that
+ * produces is a header (name, type, creator, flags, fork lengths), the data fork, and
+ * the resource fork, each followed by a CRC-16. Fork data is collected into a small
+ * buffer and handed to fork.c, with the CRC run over each buffer in one go.
+ */
+
+#define BH_ALPHABET  "!\"#$%&'()*+,-012345689@ABCDEFGHIJKLMNPQRSTUVXYZ[`abcdefhijklmpqr"
+#define BH_SKIP      0xFE /* line breaks and such, ignored */
+#define BH_BAD       0xFF /* not legal anywhere */
+
+#define BH_RLE       0x90
+
+/* overall progress through the text */
+#define BH_PREAMBLE  0
+#define BH_TEXT      1
+#define BH_END       2
+#define BH_ERROR     3
+
+/* progress through the decoded data */
+#define BH_HEAD      0
+#define BH_DATA      1
+#define BH_DCRC      2
+#define BH_RSRC      3
+#define BH_RCRC      4
+#define BH_DONE      5
+
+#define BH_HEAD_MAX  86 /* 63 character name plus fixed fields */
+#define BH_OUT_SIZE  512
+
+static unsigned char table[256];
+static Boolean table_ready;
+
+static short phase, stage, nbits, head_len;
+static Boolean head_only, rle_pending;
+static unsigned char last;
+static unsigned long bits;
+static long remain;
+static unsigned short crc, crc_got;
+static unsigned char head[BH_HEAD_MAX];
+static unsigned char out[BH_OUT_SIZE];
+static short out_len, err;
+
+/**
+ * Builds the character decoding table, once.
+ */
+static void binhex_table(void)
+{
+	short i;
+	unsigned char *a;
+
+	if (table_ready) return;
+
+	for (i = 0; i < 256; i++) {
+		table[i] = BH_BAD;
+	}
+	a = (unsigned char *) BH_ALPHABET;
+	for (i = 0; i < 64; i++) {
+		table[a[i]] = i;
+	}
+	table['\r'] = BH_SKIP;
+	table['\n'] = BH_SKIP;
+	table['\t'] = BH_SKIP;
+	table[' '] = BH_SKIP;
+
+	table_ready = true;
+}
+
+/**
+ * @return  the length of the header, once the name length is known.
+ */
+static short binhex_head_size(void)
+{
+	/* length, name, version, type, creator, flags, two lengths, CRC */
+	return 1 + head[0] + 1 + 4 + 4 + 2 + 4 + 4 + 2;
+}
+
+/**
+ * Sends the buffered fork data to the output file, checksumming it on the way.
+ */
+static void binhex_flush(void)
+{
+	if (out_len <= 0) return;
+
+	crc = crc16_update(crc, out, out_len);
+	if (! head_only) {
+		err = fork_write(stage == BH_DATA ? FORK_DATA : FORK_RSRC, (char *) out, out_len);
+		if (err) phase = BH_ERROR;
+	}
+	out_len = 0;
+}
+
+/**
+ * Moves on to the next part of the decoded data.
+ *
+ * @param next  the stage to move to.
+ * @param len   how many bytes long that stage is.
+ */
+static void binhex_stage(short next, long len)
+{
+	stage = next;
+	remain = len;
+	if (stage == BH_DCRC || stage == BH_RCRC) {
+		crc_got = 0;
+	} else if (stage == BH_DATA || stage == BH_RSRC) {
+		crc = 0;
+		if (remain == 0) {
+			/* empty fork, go straight to its CRC */
+			binhex_stage(stage + 1, 2);
+		}
+	}
+}
+
+/**
+ * Handles one byte of decoded (after run-length expansion) data.
+ *
+ * @param b  the byte.
+ */
+static void binhex_byte(unsigned char b)
+{
+	switch (stage) {
+	case BH_HEAD:
+		head[head_len++] = b;
+		if (head_len == 1 && (b < 1 || b > 63)) {
+			phase = BH_ERROR;
+		} else if (head_len > 1 && head_len == binhex_head_size()) {
+			crc = crc16_update(0, head, head_len - 2);
+			if (crc != be16(&(head[head_len - 2]))) {
+				phase = BH_ERROR;
+			} else if (head_only) {
+				phase = BH_END;
+			} else {
+				binhex_stage(BH_DATA, be32(&(head[head[0] + 12])));
+			}
+		}
+		break;
+	case BH_DATA:
+	case BH_RSRC:
+		out[out_len++] = b;
+		if (--remain == 0) {
+			binhex_flush();
+			binhex_stage(stage + 1, 2);
+		} else if (out_len == BH_OUT_SIZE) {
+			binhex_flush();
+		}
+		break;
+	case BH_DCRC:
+	case BH_RCRC:
+		crc_got = (crc_got << 8) | b;
+		if (--remain == 0) {
+			if (crc_got != crc) {
+				phase = BH_ERROR;
+			} else if (stage == BH_DCRC) {
+				binhex_stage(BH_RSRC, be32(&(head[head[0] + 16])));
+			} else {
+				stage = BH_DONE;
+			}
+		}
+		break;
+	default:
+		/* trailing data after the resource fork CRC is ignored */
+		break;
+	}
+}
+
+/**
+ * Feeds text to the decoder, from the point the last call left off.
+ *
+ * @param buf  the text.
+ * @param len  its length.
+ */
+static void binhex_decode(unsigned char *buf, long len)
+{
+	register unsigned char v;
+	unsigned char b;
+	short i;
+
+	while (len-- > 0 && phase < BH_END) {
+		v = *buf++;
+
+		if (phase == BH_PREAMBLE) {
+			/* data starts after the first colon, the magic line has none */
+			if (v == ':') phase = BH_TEXT;
+			continue;
+		}
+
+		if (v == ':') {
+			/* end of the data */
+			phase = BH_END;
+			break;
+		}
+		v = table[v];
+		if (v == BH_SKIP) continue;
+		if (v == BH_BAD) {
+			phase = BH_ERROR;
+			break;
+		}
+
+		bits = (bits << 6) | v;
+		nbits += 6;
+		if (nbits < 8) continue;
+		nbits -= 8;
+		b = (bits >> nbits) & 0xFF;
+
+		/* run-length expansion */
+		if (rle_pending) {
+			rle_pending = false;
+			if (b == 0) {
+				last = BH_RLE;
+				binhex_byte(BH_RLE);
+			} else {
+				for (i = 1; i < b && phase < BH_END; i++) {
+					binhex_byte(last);
+				}
+			}
+		} else if (b == BH_RLE) {
+			rle_pending = true;
+		} else {
+			last = b;
+			binhex_byte(b);
+		}
+	}
+}
+
+/**
+ * Checks if the start of a file is BinHex 4.0 and, if so, decodes the header to get
+ * what is needed to create the output file. The header must be within the data
+ * given, which is not a problem for a block or more of a normal BinHex file.
+ *
+ * This leaves the decoder ready to start from the beginning of the file.
+ *
+ * @param buf   the start of the file.
+ * @param len   the length of the data given.
+ * @param info  set to the name, type, creator, flags, and fork lengths.
+ * @return      true if this is a usable BinHex file, false otherwise.
+ */
+Boolean binhex_head(unsigned char *buf, long len, ForkInfo *info)
+{
+	Boolean ok;
+	short nlen;
+
+	if (len < sizeof(BINHEX_MAGIC) - 1
+			|| ! str_eq((char *) buf, BINHEX_MAGIC, sizeof(BINHEX_MAGIC) - 1)) {
+		return false;
+	}
+
+	binhex_start();
+	head_only = true;
+	binhex_decode(buf, len);
+	/* the closing colon also ends it, so make sure the whole header was there */
+	ok = (phase == BH_END && stage == BH_HEAD
+			&& head_len > 1 && head_len == binhex_head_size());
+
+	if (ok) {
+		/* HFS names are at most 31 characters */
+		nlen = (head[0] > 31 ? 31 : head[0]);
+		BlockMove(&(head[1]), &(info->name[1]), nlen);
+		info->name[0] = nlen;
+		repl_chars(info->name, ':', '-');
+		info->type = be32(&(head[head[0] + 2]));
+		info->creator = be32(&(head[head[0] + 6]));
+		info->flags = be16(&(head[head[0] + 10]));
+		info->dlen = be32(&(head[head[0] + 12]));
+		info->rlen = be32(&(head[head[0] + 16]));
+		info->crdate = 0;
+		info->mddate = 0;
+		info->set_info = true;
+		ok = (info->dlen >= 0 && info->rlen >= 0);
+	}
+
+	binhex_start();
+	return ok;
+}
+
+/**
+ * Resets the decoder to the start of a file.
+ */
+void binhex_start(void)
+{
+	binhex_table();
+	phase = BH_PREAMBLE;
+	stage = BH_HEAD;
+	head_only = false;
+	rle_pending = false;
+	head_len = 0;
+	nbits = 0;
+	bits = 0;
+	last = 0;
+	out_len = 0;
+	crc = 0;
+	err = 0;
+}
+
+/**
+ * Decodes the next piece of a BinHex file, writing fork data to the file currently
+ * open in fork.c. The file must have been created with the information from
+ * binhex_head().
+ *
+ * @param buf  the text, which must directly follow the previous piece.
+ * @param len  its length.
+ * @return     zero on success, FORK_BAD_DATA if the text is damaged, or the OSErr
+ *             from writing the file.
+ */
+short binhex_feed(unsigned char *buf, long len)
+{
+	binhex_decode(buf, len);
+	if (phase == BH_ERROR) {
+		return (err ? err : FORK_BAD_DATA);
+	}
+	return 0;
+}
+
+/**
+ * @return  true if both forks have been decoded and their CRCs checked.
+ */
+Boolean binhex_done(void)
+{
+	return phase != BH_ERROR && stage == BH_DONE;
+}
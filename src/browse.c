@@ -0,0 +1,247 @@
+/*
+ * Copyright (C) 2026 saybur
+ *
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this
+ * program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "browse.h"
+#include "constants.h"
+#include "dialog.h"
+#include "image.h"
+#include "list.h"
+#include "util.h"
+
+/*
+ * This compilation unit shows the contents of a disk image on the device in a modal
+ * dialog, one folder at a time. Folders are opened in place and files are copied out
+ * with image_extract(), so only what is looked at or asked for is read.
+ */
+
+#define BROWSE_OPEN    1
+#define BROWSE_DONE    2
+#define BROWSE_BACK    3
+#define BROWSE_LIST    4
+#define BROWSE_PATH    5
+#define BROWSE_BORDER  6
+
+static ListHandle blist;
+static Rect lrect;
+
+/**
+ * Draws the list and the frame around it.
+ *
+ * @param w  the dialog.
+ * @param i  the item number of the list.
+ */
+pascal static void browse_draw_list(WindowPtr w, short i)
+{
+	Rect r;
+
+	r = lrect;
+	InsetRect(&r, -1, -1);
+	FrameRect(&r);
+	LUpdate(w->visRgn, blist);
+}
+
+/**
+ * Filter for ModalDialog() that passes clicks and typing to the list. Return and
+ * Enter, or a double click, count as the Open button.
+ */
+pascal static Boolean browse_filter(DialogPtr d, EventRecord *evt, short *item)
+{
+	Point p;
+	char c;
+
+	SetPort(d);
+	if (evt->what == mouseDown) {
+		p = evt->where;
+		GlobalToLocal(&p);
+		if (PtInRect(p, &lrect)) {
+			*item = (LClick(p, evt->modifiers, blist) ? BROWSE_OPEN : BROWSE_LIST);
+			return true;
+		}
+	} else if (evt->what == keyDown || evt->what == autoKey) {
+		c = evt->message & charCodeMask;
+		if (c == 0x0D || c == 0x03) {
+			*item = BROWSE_OPEN;
+		} else {
+			list_key(blist, evt);
+			*item = BROWSE_LIST;
+		}
+		return true;
+	}
+	return false;
+}
+
+/**
+ * Shows the name of the directory being listed. This uses ParamText(), which alerts
+ * also use, so it is called again after anything that may have shown an alert.
+ *
+ * @param d  the dialog.
+ */
+static void browse_path(DialogPtr d)
+{
+	Str255 name;
+	short item_type;
+	Handle item_handle;
+	Rect rect;
+
+	image_dir(name, 0L);
+	ParamText(name, 0, 0, 0);
+	GetDItem(d, BROWSE_PATH, &item_type, &item_handle, &rect);
+	InvalRect(&rect);
+}
+
+/**
+ * Fills the list from the directory in the image entry table. Folders are shown
+ * with a trailing colon, as in a Mac path.
+ *
+ * @param d  the dialog.
+ */
+static void browse_fill(DialogPtr d)
+{
+	ImageEntry e;
+	Point p;
+	Str63 cell;
+	long i, count;
+
+	LDoDraw(false, blist);
+	LDelRow(0, 0, blist);
+	count = image_count();
+	if (count > 0) {
+		LAddRow((short) count, 0, blist);
+	}
+	for (i = 0; i < count; i++) {
+		image_get(i, &e);
+		BlockMove(e.name, cell, e.name[0] + 1);
+		if (e.folder) {
+			/* a 31 character name leaves no room for this in the entry */
+			cell[++cell[0]] = ':';
+		}
+		SetPt(&p, 0, (short) i);
+		LSetCell(&(cell[1]), cell[0], p, blist);
+	}
+	LDoDraw(true, blist);
+	InvalRect(&lrect);
+	browse_path(d);
+}
+
+/**
+ * Lists another directory, telling the user if it could not be read.
+ *
+ * @param d    the dialog.
+ * @param dir  the directory ID.
+ */
+static void browse_list(DialogPtr d, long dir)
+{
+	long err;
+
+	busy_cursor();
+	err = image_list(dir);
+	SetCursor(&arrow);
+	if (err) {
+		image_alert(err);
+	}
+	browse_fill(d);
+}
+
+/**
+ * Opens the selected folder, or asks where to put the selected file and copies it
+ * out of the image.
+ *
+ * @param d  the dialog.
+ */
+static void browse_open(DialogPtr d)
+{
+	ImageEntry e;
+	Point p;
+	SFReply reply;
+	Str255 prompt;
+	short row;
+
+	SetPt(&p, 0, 0);
+	if (! LGetSelect(true, &p, blist)) return;
+	row = p.v;
+	if (! image_get(row, &e)) return;
+
+	if (e.folder) {
+		browse_list(d, e.id);
+	} else {
+		str_load(STR_GENERAL, STRI_GEN_EXTRACT, prompt, 255);
+		SetPt(&p, 40, 40);
+		SFPutFile(p, prompt, e.name, 0L, &reply);
+		if (reply.good) {
+			image_extract(row, reply.fName, reply.vRefNum);
+		}
+		browse_path(d);
+	}
+}
+
+/**
+ * Shows the contents of a disk image in the file list and lets the user copy files
+ * out of it. Returns once the user is done.
+ *
+ * @param scsi  the SCSI ID of the device.
+ * @param item  the item in the file list.
+ */
+void browse_image(short scsi, short item)
+{
+	DialogPtr dialog;
+	short item_hit, item_type;
+	Handle item_handle;
+	Rect rect, data_bounds;
+	Point cell_size, p;
+	long parent;
+
+	if (! image_open(scsi, item)) return;
+
+	dialog = GetNewDialog(DLOG_BROWSE, 0L, (WindowPtr) -1);
+	if (! dialog) {
+		mem_fail();
+	}
+	SetPort(dialog);
+
+	/* list goes in the user item, less room for the scroll bar */
+	GetDItem(dialog, BROWSE_LIST, &item_type, &item_handle, &lrect);
+	SetDItem(dialog, BROWSE_LIST, item_type, (Handle) browse_draw_list, &lrect);
+	rect = lrect;
+	rect.right -= 15;
+	SetRect(&data_bounds, 0, 0, 1, 0);
+	SetPt(&cell_size, 0, 0);
+	blist = LNew(&rect, &data_bounds, cell_size, 0, dialog, true, false, false, true);
+	if (! blist) {
+		mem_fail();
+	}
+	(**blist).selFlags = lOnlyOne;
+
+	GetDItem(dialog, BROWSE_BORDER, &item_type, &item_handle, &rect);
+	SetDItem(dialog, BROWSE_BORDER, item_type, (Handle) dialog_default_border, &rect);
+
+	browse_fill(dialog);
+	ShowWindow(dialog);
+	do {
+		ModalDialog((ModalFilterProcPtr) browse_filter, &item_hit);
+
+		if (item_hit == BROWSE_OPEN) {
+			browse_open(dialog);
+		} else if (item_hit == BROWSE_BACK) {
+			if (image_dir(0L, &parent) != image_root()) {
+				browse_list(dialog, parent);
+			}
+		}
+	} while (item_hit != BROWSE_DONE);
+
+	LDispose(blist);
+	DisposDialog(dialog);
+	image_close();
+}
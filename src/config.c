@@ -21,10 +21,31 @@
 
 Boolean g_use_wne;
 Boolean g_use_qdcolor;
+Boolean g_verify_upload;
+Boolean g_decode_macbin;
+Boolean g_decode_binhex;
+Boolean g_upload_macbin;
+Boolean g_watch_device;
 
 static unsigned char mode_checked;
+static unsigned char mode_forced;
 static unsigned char capabilities[8];
 
+/**
+ * Re-reads the capabilities of a previously checked device if the SCSI bus was
+ * reset since they were fetched. The emulator may have restarted during that time,
+ * so the old information can't be trusted.
+ *
+ * @param scsi  SCSI ID to check against, between 0-6.
+ */
+static void config_reprobe(short scsi)
+{
+	if (scsi_take_reset(scsi) && (mode_checked & (1 << scsi))) {
+		/* as with the initial check, errors just leave the original capabilities */
+		scsi_get_emu_capabilities(scsi, &(capabilities[scsi]));
+	}
+}
+
 /**
  * Reads the 0x31 mode page and sets version information appropriately.
  *
@@ -54,6 +75,7 @@ Boolean config_check_mode(short scsi)
 
 	if (scsi < 0 || scsi > 6) return false;
 	mask = 1 << scsi;
+	config_reprobe(scsi);
 
 	/* have we already checked? */
 	if (mode_checked & mask) {
@@ -81,6 +103,7 @@ Boolean config_check_mode(short scsi)
 		if (CautionAlert(ALRT_EMU_MODEPAGE, 0) == 1) {
 			/* user is OK trying anyway, don't ask again */
 			mode_checked |= mask;
+			mode_forced |= mask;
 			valid = true;
 		} else {
 			valid = false;
@@ -96,6 +119,34 @@ Boolean config_check_mode(short scsi)
 	return valid;
 }
 
+/**
+ * Forgets what is known about a device and checks it again. This is for when the
+ * device reports UNIT ATTENTION, which means it was restarted or had its card
+ * swapped, possibly for one running different firmware.
+ *
+ * Devices the user already chose to connect to anyway are not asked about again,
+ * only their capabilities are refreshed.
+ *
+ * @param scsi  SCSI ID to check against, between 0-6.
+ * @return      true if connecting should continue, false otherwise.
+ */
+Boolean config_recheck(short scsi)
+{
+	unsigned char mask;
+
+	if (scsi < 0 || scsi > 6) return false;
+	mask = 1 << scsi;
+
+	if (mode_forced & mask) {
+		scsi_get_emu_capabilities(scsi, &(capabilities[scsi]));
+		return true;
+	}
+
+	mode_checked &= ~mask;
+	capabilities[scsi] = 0;
+	return config_check_mode(scsi);
+}
+
 /**
  * Uses the post-Feb 2026 capabilities information to check if newer features
  * are available.
@@ -107,6 +158,7 @@ Boolean config_check_mode(short scsi)
 Boolean config_has_capability(short scsi, short feature)
 {
 	if (scsi < 0 || scsi > 6) return false;
+	config_reprobe(scsi);
 	return capabilities[scsi] & feature;
 }
 
@@ -118,6 +170,12 @@ void config_init(void)
 	long gr;
 
 	mode_checked = 0;
+	mode_forced = 0;
+	g_verify_upload = false;
+	g_decode_macbin = false;
+	g_decode_binhex = false;
+	g_upload_macbin = false;
+	g_watch_device = false;
 
 	if (! trap_available(_Gestalt)) {
 		g_use_wne = false;
@@ -19,12 +19,19 @@
 
 #define CAP_LARGE_RECEIVE     1
 #define CAP_LARGE_SEND        2
+#define CAP_CHECKSUM          4
 
 extern Boolean g_use_wne;
 extern Boolean g_use_qdcolor;
+extern Boolean g_verify_upload;
+extern Boolean g_decode_macbin;
+extern Boolean g_decode_binhex;
+extern Boolean g_upload_macbin;
+extern Boolean g_watch_device;
 
 Boolean config_check_mode(short scsi);
 Boolean config_has_capability(short scsi, short feature);
+Boolean config_recheck(short scsi);
 void config_init(void);
 
 #endif /* __CONFIGH__ */
@@ -25,6 +25,11 @@
 
 #define WAIT_EVENT_SLEEP    30
 #define SCSI_TIMEOUT        180
+#define SCSI_TIMEOUT_MIN    20   /* floor for adaptive completion timeouts */
+#define SCSI_TIMEOUT_MAX    1800 /* ceiling, even for the slowest SD cards */
+#define SCSI_TIMEOUT_UNIT   30   /* extra per 4K while latency is unknown */
+#define SCSI_TIMEOUT_CRC_MB 120  /* per MB the device has to checksum */
+#define SCSI_RESET_SETTLE   120  /* wait after a bus reset before probing */
 #define WINDOW_MIN_HEIGHT   200
 
 /* This is more than what is actually allowed (100), here for possible future changes */
@@ -47,6 +52,7 @@
 #define ALRT_DUPLICATES     132
 #define ALRT_UPLOAD_DUP     133
 #define ALRT_EMU_MODEPAGE   134
+#define ALRT_NO_SPACE       135
 #define ALRT_GENERIC        256
 #define ALRT_BAD_VERSION    257
 #define ALRT_SCSI_ERROR     258
@@ -55,6 +61,10 @@
 #define CNTL_STOP           128
 
 #define DLOG_OPEN           512
+#define DLOG_VOLUME         513
+#define DLOG_BROWSE         514
+#define DLOG_PREVIEW        515
+#define DLOG_RANGE          516
 
 #define ICON_EMU            128
 #define ICON_DEVICE         129
@@ -64,10 +74,21 @@
 #define MENU_APPLE          128
 #define MENU_FILE           129
 #define MENU_EDIT           130
+#define MENU_OPTIONS        131
 
 #define MENUI_OPEN          1
 #define MENUI_UPLOAD        3
-#define MENUI_QUIT          5
+#define MENUI_UPLOAD_VOL    4
+#define MENUI_RANGE         5
+#define MENUI_PREVIEW       6
+#define MENUI_BROWSE        7
+#define MENUI_MOUNT         8
+#define MENUI_QUIT          10
+#define MENUI_VERIFY        1
+#define MENUI_MACBIN        2
+#define MENUI_BINHEX        3
+#define MENUI_UP_MACBIN     4
+#define MENUI_WATCH         5
 
 #define STR_GENERAL         128
 
@@ -89,6 +110,8 @@
 #define STRI_GEN_HEAD_DEV   7
 #define STRI_GEN_HEAD_FILE  8
 #define STRI_GEN_HEAD_IMG   9
+#define STRI_GEN_MANIFEST   10
+#define STRI_GEN_EXTRACT    11
 
 #define STRI_GA_NSF         1
 #define STRI_GA_NSI         2
@@ -99,5 +122,18 @@
 #define STRI_GA_EJECT_ERR   7
 #define STRI_GA_UP_BADLEN   8
 #define STRI_GA_UP_BADCHAR  9
+#define STRI_GA_CRC_BAD     10
+#define STRI_GA_VERIFY_BAD  11
+#define STRI_GA_VERIFY_NSF  12
+#define STRI_GA_DECODE_BAD  13
+#define STRI_GA_VOL_BIG     14
+#define STRI_GA_IMG_UNKNOWN 15
+#define STRI_GA_IMG_BAD     16
+#define STRI_GA_IMG_METHOD  17
+#define STRI_GA_VD_HFS      18
+#define STRI_GA_VD_ONE      19
+#define STRI_GA_VD_ERR      20
+#define STRI_GA_RANGE_BAD   21
+#define STRI_GA_NO_VOL      22
 
 #endif /* __CONSTANTSH__ */
@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2024 saybur
+ * Copyright (C) 2024-2026 saybur
  *
  * This program is free software: you can redistribute it and/or modify it under the
  * terms of the GNU General Public License as published by the Free Software
@@ -18,6 +18,12 @@
 #include "dialog.h"
 #include "util.h"
 
+/* items in the volume dialog */
+#define VOLUME_FIRST   3  /* volume radios, six of them */
+#define VOLUME_SIZE    9  /* block size radios, 8K, 16K and 32K */
+#define VOLUME_LINE    14
+#define VOLUME_BORDER  15
+
 /**
  * Handles drawing a dot pattern across elements of a dialog.
  *
@@ -48,7 +54,7 @@ pascal static void draw_dots(WindowPtr w, short i)
  * @param w  the window to apply against.
  * @param i  the item number to draw into.
  */
-pascal static void draw_default_border(WindowPtr w, short i)
+pascal void dialog_default_border(WindowPtr w, short i)
 {
 	short itype;
 	Handle ihandle;
@@ -100,7 +106,7 @@ Boolean dialog_open(short *scsi, short *open_type)
 
 		/* assign the default item border drawing code */
 		GetDItem(dialog, 15, &item_type, &item_handle, &rect);
-		SetDItem(dialog, 15, item_type, (Handle) draw_default_border, &rect);
+		SetDItem(dialog, 15, item_type, (Handle) dialog_default_border, &rect);
 
 		/* SCSI radios are 3-9 for IDs 0-6; unsel last, sel new */
 		GetDItem(dialog, *scsi + 3, &item_type, &item_handle, &rect);
@@ -147,3 +153,239 @@ Boolean dialog_open(short *scsi, short *open_type)
 
 	return false;
 }
+
+/**
+ * Presents a modal dialog asking the user which mounted volume to send to the
+ * device as a disk image, and how much of it to read per transfer. Only the first
+ * six volumes that are on a drive are offered; the rest of the radios are hidden.
+ *
+ * @param vref    the chosen volume reference number.
+ * @param blocks  the read size, in 512 byte blocks.
+ * @return        true if user selected OK, false otherwise.
+ */
+Boolean dialog_volume(short *vref, short *blocks)
+{
+	DialogPtr dialog;
+	VolumeParam pb;
+	short item_hit, item_type, sel_vol, sel_size, count, i;
+	short vrefs[6];
+	Handle item_handle;
+	Rect rect;
+	Str255 name;
+
+	dialog = GetNewDialog(DLOG_VOLUME, 0L, (WindowPtr) -1);
+	if (! dialog) {
+		mem_fail();
+		return false;
+	}
+
+	/* assign separator and default item border drawing code */
+	GetDItem(dialog, VOLUME_LINE, &item_type, &item_handle, &rect);
+	SetDItem(dialog, VOLUME_LINE, item_type, (Handle) draw_dots, &rect);
+	GetDItem(dialog, VOLUME_BORDER, &item_type, &item_handle, &rect);
+	SetDItem(dialog, VOLUME_BORDER, item_type, (Handle) dialog_default_border, &rect);
+
+	/* volume radios are titled from the mounted volumes that have a drive */
+	count = 0;
+	for (i = 1; count < 6; i++) {
+		pb.ioCompletion = 0;
+		pb.ioNamePtr = name;
+		pb.ioVRefNum = 0;
+		pb.ioVolIndex = i;
+		if (PBGetVInfo((ParmBlkPtr) &pb, false)) break;
+		if (pb.ioVDrvInfo == 0) continue; /* offline or not on a drive */
+
+		GetDItem(dialog, count + VOLUME_FIRST, &item_type, &item_handle, &rect);
+		SetCTitle((ControlHandle) item_handle, name);
+		vrefs[count++] = pb.ioVRefNum;
+	}
+	for (i = count; i < 6; i++) {
+		HideDItem(dialog, i + VOLUME_FIRST);
+	}
+	if (count == 0) {
+		DisposDialog(dialog);
+		alert_template(0, ALRT_GENERIC, STRI_GA_NO_VOL);
+		return false;
+	}
+	sel_vol = 0;
+	GetDItem(dialog, VOLUME_FIRST, &item_type, &item_handle, &rect);
+	SetCtlValue((ControlHandle) item_handle, 1);
+
+	/* start at the largest block size */
+	sel_size = 2;
+	GetDItem(dialog, sel_size + VOLUME_SIZE, &item_type, &item_handle, &rect);
+	SetCtlValue((ControlHandle) item_handle, 1);
+
+	ShowWindow(dialog);
+	do {
+		ModalDialog(0L, &item_hit);
+
+		if (item_hit >= VOLUME_SIZE + 3) {
+			continue;
+		} else if (item_hit >= VOLUME_SIZE) {
+			GetDItem(dialog, sel_size + VOLUME_SIZE, &item_type, &item_handle, &rect);
+			SetCtlValue((ControlHandle) item_handle, 0);
+			sel_size = item_hit - VOLUME_SIZE;
+			GetDItem(dialog, item_hit, &item_type, &item_handle, &rect);
+			SetCtlValue((ControlHandle) item_handle, 1);
+		} else if (item_hit >= VOLUME_FIRST) {
+			GetDItem(dialog, sel_vol + VOLUME_FIRST, &item_type, &item_handle, &rect);
+			SetCtlValue((ControlHandle) item_handle, 0);
+			sel_vol = item_hit - VOLUME_FIRST;
+			GetDItem(dialog, item_hit, &item_type, &item_handle, &rect);
+			SetCtlValue((ControlHandle) item_handle, 1);
+		}
+	} while (item_hit >= VOLUME_FIRST);
+	DisposDialog(dialog);
+
+	if (item_hit == 1) {
+		*vref = vrefs[sel_vol];
+		*blocks = 16 << sel_size;
+		return true;
+	}
+	return false;
+}
+
+/**
+ * Reads a size typed into the range dialog. Sizes are decimal, or hex if they start
+ * with "$" or "0x", may be negative, and may end in K or M for kilobytes or
+ * megabytes. Spaces are ignored.
+ *
+ * @param s  the text of the item.
+ * @param v  set to the size found.
+ * @return   true if the text was a valid size, false if it was empty or not valid.
+ */
+static Boolean dialog_size(unsigned char *s, long *v)
+{
+	short i, base, d, shift;
+	Boolean neg, any;
+	char c;
+
+	*v = 0;
+	neg = false;
+	any = false;
+	base = 10;
+	shift = 0;
+	for (i = 1; i <= s[0]; i++) {
+		c = lowerc(s[i]);
+		if (c == ' ') continue;
+		if (shift) return false; /* nothing allowed after the suffix */
+
+		if (c == '-' && ! any && ! neg && base == 10) {
+			neg = true;
+		} else if (c == '$' && ! any && base == 10) {
+			base = 16;
+		} else if (c == 'x' && any && *v == 0 && base == 10) {
+			base = 16;
+			any = false;
+		} else if (c == 'k' && any) {
+			shift = 10;
+		} else if (c == 'm' && any) {
+			shift = 20;
+		} else {
+			if (c >= '0' && c <= '9') {
+				d = c - '0';
+			} else if (base == 16 && c >= 'a' && c <= 'f') {
+				d = c - 'a' + 10;
+			} else {
+				return false;
+			}
+			if (*v > (0x7FFFFFFFL - d) / base) return false;
+			*v = *v * base + d;
+			any = true;
+		}
+	}
+	if (! any) return false;
+	if (shift) {
+		if (*v > (0x7FFFFFFFL >> shift)) return false;
+		*v <<= shift;
+	}
+	if (neg) *v = -*v;
+	return true;
+}
+
+/**
+ * Presents a modal dialog asking the user for the part of a file to download. The
+ * start may be negative to count back from the end of the file, and an empty length
+ * means everything after the start. A range running past the end of the file is
+ * cut short. The dialog stays up until the range is valid or the user cancels.
+ *
+ * @param name    the name of the file.
+ * @param size    the size of the file.
+ * @param offset  set to where the range starts.
+ * @param length  set to the length of the range.
+ * @return        true if user selected OK, false otherwise.
+ */
+Boolean dialog_range(unsigned char *name, long size, long *offset, long *length)
+{
+	DialogPtr dialog;
+	short item_hit, item_type, bad;
+	Handle item_handle;
+	Rect rect;
+	Str255 text;
+	Str15 sizestr;
+	long start, len;
+
+	NumToString(size, sizestr);
+	ParamText(name, sizestr, 0, 0);
+
+	dialog = GetNewDialog(DLOG_RANGE, 0L, (WindowPtr) -1);
+	if (! dialog) {
+		mem_fail();
+		return false;
+	}
+
+	GetDItem(dialog, 9, &item_type, &item_handle, &rect);
+	SetDItem(dialog, 9, item_type, (Handle) dialog_default_border, &rect);
+	SelIText(dialog, 5, 0, 32767);
+
+	ShowWindow(dialog);
+	do {
+		ModalDialog(0L, &item_hit);
+		if (item_hit != 1) continue;
+
+		/* start, counting back from the end if negative */
+		GetDItem(dialog, 5, &item_type, &item_handle, &rect);
+		GetIText(item_handle, text);
+		bad = 5;
+		if (dialog_size(text, &start)) {
+			if (start < 0) start += size;
+			if (start >= 0 && start < size) bad = 0;
+		}
+
+		/* length, up to the end if empty */
+		if (! bad) {
+			GetDItem(dialog, 7, &item_type, &item_handle, &rect);
+			GetIText(item_handle, text);
+			bad = 7;
+			if (text[0] == 0) {
+				len = size - start;
+				bad = 0;
+			} else if (dialog_size(text, &len) && len > 0) {
+				if (len > size - start) len = size - start;
+				bad = 0;
+			}
+		}
+
+		if (bad) {
+			alert_template(0, ALRT_GENERIC, STRI_GA_RANGE_BAD);
+
+			/* the alert replaced the prompt text, put it back */
+			SetPort(dialog);
+			ParamText(name, sizestr, 0, 0);
+			GetDItem(dialog, 3, &item_type, &item_handle, &rect);
+			InvalRect(&rect);
+
+			SelIText(dialog, bad, 0, 32767);
+			item_hit = 0;
+		}
+	} while (item_hit != 1 && item_hit != 2);
+	DisposDialog(dialog);
+
+	if (item_hit == 1) {
+		*offset = start;
+		*length = len;
+		return true;
+	}
+	return false;
+}
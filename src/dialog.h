@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2024 saybur
+ * Copyright (C) 2024-2026 saybur
  *
  * This program is free software: you can redistribute it and/or modify it under the
  * terms of the GNU General Public License as published by the Free Software
@@ -17,6 +17,9 @@
 #ifndef __DIALOGH__
 #define __DIALOGH__
 
+pascal void dialog_default_border(WindowPtr w, short i);
 Boolean dialog_open(short *scsi, short *open_type);
+Boolean dialog_volume(short *vref, short *blocks);
+Boolean dialog_range(unsigned char *name, long size, long *offset, long *length);
 
 #endif /* __DIALOGH__ */
@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2024 saybur
+ * Copyright (C) 2024-2026 saybur
  *
  * This program is free software: you can redistribute it and/or modify it under the
  * terms of the GNU General Public License as published by the Free Software
@@ -14,15 +14,31 @@
  * program. If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include "adouble.h"
+#include "config.h"
 #include "constants.h"
 #include "emu.h"
+#include "names.h"
+#include "peek.h"
 #include "scsi.h"
 #include "util.h"
+#include "vdisk.h"
 #include "window.h"
 
+/* room for a folded file name to sort and compare on, see emu_populate_list() */
+#define EMU_KEY_SIZE  32
+
 static short emu_count;
 static short emu_index[MAXIMUM_FILES];
 static long emu_sizes[MAXIMUM_FILES];
+static short emu_side_index[MAXIMUM_FILES];
+static long emu_side_sizes[MAXIMUM_FILES];
+static NameIndex *emu_names;
+static Handle emu_keys;
+
+/* listings as last fetched, by SCSI ID then files/images; see emu_fill() */
+static Handle cache_data[7][2];
+static short cache_count[7][2];
 
 /**
  * Perform an ejection of the device at the given SCSI ID.
@@ -151,7 +167,19 @@ static Boolean emu_eject(short scsi_id)
  */
 void emu_init(void)
 {
+	short i;
+
 	emu_count = 0;
+	for (i = 0; i < 7; i++) {
+		cache_data[i][0] = 0;
+		cache_data[i][1] = 0;
+		cache_count[i][0] = -1;
+		cache_count[i][1] = -1;
+	}
+	emu_names = names_new();
+	if (! (emu_keys = NewHandle(0))) {
+		mem_fail();
+	}
 }
 
 /**
@@ -181,6 +209,407 @@ Boolean emu_get_info(short item, short *index, long *size)
 	return true;
 }
 
+/**
+ * Gets information about the AppleDouble sidecar ("._name") of an item, if it has
+ * one. Sidecars paired with an item are not listed on their own.
+ *
+ * @param item    the item number to look up.
+ * @param *index  set to the file index of the sidecar.
+ * @param *size   set to the size of the sidecar.
+ * @return        true if the item has a sidecar, false otherwise.
+ */
+Boolean emu_get_sidecar(short item, short *index, long *size)
+{
+	if (item < 0 || item >= emu_count || emu_side_index[item] < 0) return false;
+
+	*index = emu_side_index[item];
+	*size = emu_side_sizes[item];
+	return true;
+}
+
+/**
+ * Finds an item in the listing by name. Comparison is case-insensitive, like the
+ * FAT filesystems on the devices.
+ *
+ * @param name   the Pascal name to look for.
+ * @param *item  set to the item number if found.
+ * @return       true if found, false otherwise.
+ */
+Boolean emu_find(unsigned char *name, short *item)
+{
+	short i;
+
+	if ((i = names_find(emu_names, name)) < 0) {
+		return false;
+	}
+	*item = i;
+	return true;
+}
+
+/**
+ * Forgets the cached listing for a device and mode.
+ *
+ * @param scsi_id  the target SCSI ID.
+ * @param t        0 for files, 1 for images.
+ */
+static void emu_cache_forget(short scsi_id, short t)
+{
+	if (cache_data[scsi_id][t]) {
+		DisposHandle(cache_data[scsi_id][t]);
+		cache_data[scsi_id][t] = 0;
+	}
+	cache_count[scsi_id][t] = -1;
+}
+
+/**
+ * Loads the file or image listing of a device into the window once the number of
+ * items is known, fetching it first unless allowed to use the cached copy.
+ *
+ * Each device and mode keeps the listing as it was last fetched, in a purgeable
+ * handle so the Memory Manager can take it back if room runs short. The device is
+ * always asked how many items it has first, which is a single byte; when using the
+ * cache and that count still matches, the full listing is not fetched again. The
+ * devices have no way to report a checksum of their listing, so a change that keeps
+ * the count the same is only seen when the listing is fetched in full.
+ *
+ * @param scsi_id    the target SCSI ID.
+ * @param open_type  zero for files, non-zero for images.
+ * @param n          the number of items, from scsi_count_files().
+ * @param cached     true if the cached listing may be used, false to fetch it.
+ * @param *count     set to the number of entries now in the listing.
+ * @return           error code from scsi.c, or zero for success.
+ */
+static long emu_fill(short scsi_id, short open_type, short n, Boolean cached,
+		short *count)
+{
+	Handle h, copy;
+	long err;
+	short length, t;
+
+	*count = 0;
+	t = (open_type ? 1 : 0);
+	h = cache_data[scsi_id][t];
+	if (! (cached && n == cache_count[scsi_id][t] && (n == 0 || (h && *h)))) {
+		emu_cache_forget(scsi_id, t);
+		if (err = scsi_list_entries(scsi_id, open_type, n, &h, &length)) {
+			return err;
+		}
+		if (length <= 0) {
+			/* handle never allocated */
+			h = 0;
+		}
+		cache_data[scsi_id][t] = h;
+		cache_count[scsi_id][t] = n;
+	}
+
+	if (h) {
+		/* parsing changes the data, so the cache keeps it as fetched */
+		HNoPurge(h);
+		copy = h;
+		if (HandToHand(&copy)) {
+			mem_fail();
+		}
+		HPurge(h);
+		*count = window_populate(scsi_id, open_type, copy, n * 40);
+		DisposHandle(copy);
+	} else {
+		*count = window_populate(scsi_id, open_type, 0, 0);
+	}
+
+	/* indexes may have moved, the mounted image needs to know */
+	vdisk_relist(scsi_id, open_type);
+	return 0;
+}
+
+/**
+ * Asks the device how many items it has, then loads the listing into the window;
+ * see emu_fill().
+ *
+ * @param scsi_id    the target SCSI ID.
+ * @param open_type  zero for files, non-zero for images.
+ * @param cached     true if the cached listing may be used, false to fetch it.
+ * @param *count     set to the number of entries now in the listing.
+ * @return           error code from scsi.c, or zero for success.
+ */
+static long emu_load(short scsi_id, short open_type, Boolean cached, short *count)
+{
+	long err;
+	short n;
+
+	*count = 0;
+	if (err = scsi_count_files(scsi_id, open_type, &n)) {
+		return err;
+	}
+	return emu_fill(scsi_id, open_type, n, cached, count);
+}
+
+/**
+ * Fetches the file or image listing from the device and loads it into the window.
+ *
+ * @param scsi_id    the target SCSI ID.
+ * @param open_type  zero for files, non-zero for images.
+ * @param *count     set to the number of entries now in the listing.
+ * @return           error code from scsi.c, or zero for success.
+ */
+long emu_list(short scsi_id, short open_type, short *count)
+{
+	return emu_load(scsi_id, open_type, false, count);
+}
+
+/**
+ * Loads the file or image listing of the device into the window, only fetching it
+ * again if the number of items has changed since it was last fetched; see
+ * emu_fill(). This suits reopening a device, or switching between files and
+ * images, where most of the time nothing has changed.
+ *
+ * @param scsi_id    the target SCSI ID.
+ * @param open_type  zero for files, non-zero for images.
+ * @param *count     set to the number of entries now in the listing.
+ * @return           error code from scsi.c, or zero for success.
+ */
+long emu_list_cached(short scsi_id, short open_type, short *count)
+{
+	return emu_load(scsi_id, open_type, true, count);
+}
+
+/**
+ * Checks whether the number of items on the device has changed since its listing
+ * was last fetched, and if so fetches the listing again. The window is then brought
+ * up to date in place, see emu_populate_list(), so selections on files that are
+ * still there are kept. When nothing has changed this costs a single one byte
+ * command.
+ *
+ * @param scsi_id    the target SCSI ID.
+ * @param open_type  zero for files, non-zero for images.
+ * @param *changed   set to true if the listing was fetched again.
+ * @return           error code from scsi.c, or zero for success.
+ */
+long emu_watch(short scsi_id, short open_type, Boolean *changed)
+{
+	long err;
+	short n, count;
+
+	*changed = false;
+	if (err = scsi_count_files(scsi_id, open_type, &n)) {
+		return err;
+	}
+	if (n == cache_count[scsi_id][open_type ? 1 : 0]) {
+		return 0;
+	}
+	*changed = true;
+	return emu_fill(scsi_id, open_type, n, false, &count);
+}
+
+/**
+ * Reconnects to a device after it reports UNIT ATTENTION: the device is checked
+ * again with config_recheck() and the listing is reloaded, since files on a new
+ * card (or even the old one) may have different indexes. Item numbers from before
+ * this call should be located again by name with emu_find().
+ *
+ * The user will have been told about any problems if this returns false.
+ *
+ * @param scsi_id    the target SCSI ID.
+ * @param open_type  zero for files, non-zero for images.
+ * @return           true if the device is ready to use again, false otherwise.
+ */
+Boolean emu_recover(short scsi_id, short open_type)
+{
+	long err;
+	short count;
+
+	if (! config_recheck(scsi_id)) {
+		return false;
+	}
+	if (err = emu_list(scsi_id, open_type, &count)) {
+		scsi_alert(err);
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Compares two sort keys made by emu_populate_list().
+ *
+ * @param a  the first key.
+ * @param b  the second key.
+ * @return   negative if a sorts first, positive if b does, zero if they are equal.
+ */
+static short emu_key_cmp(unsigned char *a, unsigned char *b)
+{
+	short i, len;
+
+	len = (a[0] < b[0] ? a[0] : b[0]);
+	for (i = 1; i <= len; i++) {
+		if (a[i] != b[i]) return a[i] - b[i];
+	}
+	return a[0] - b[0];
+}
+
+/**
+ * Sorts entries by their keys with a bottom-up merge sort. Entries with equal keys
+ * keep the order the device gave them in.
+ *
+ * @param order  the entry numbers to sort, in place.
+ * @param tmp    scratch space as long as the above.
+ * @param n      the number of entries.
+ * @param keys   the sort keys, EMU_KEY_SIZE bytes apart, by entry number.
+ */
+static void emu_sort(short *order, short *tmp, short n, unsigned char *keys)
+{
+	short w, lo, mid, hi, a, b, k;
+	short *src, *dst, *t;
+
+	src = order;
+	dst = tmp;
+	for (w = 1; w < n; w *= 2) {
+		for (lo = 0; lo < n; lo += 2 * w) {
+			mid = (lo + w < n ? lo + w : n);
+			hi = (lo + 2 * w < n ? lo + 2 * w : n);
+			a = lo;
+			b = mid;
+			for (k = lo; k < hi; k++) {
+				if (a < mid && (b >= hi || emu_key_cmp(
+						&(keys[src[a] * EMU_KEY_SIZE]),
+						&(keys[src[b] * EMU_KEY_SIZE])) <= 0)) {
+					dst[k] = src[a++];
+				} else {
+					dst[k] = src[b++];
+				}
+			}
+		}
+		t = src;
+		src = dst;
+		dst = t;
+	}
+	if (src != order) {
+		BlockMove(src, order, n * 2L);
+	}
+}
+
+/**
+ * Throws the whole list area, scroll bar included, out to be drawn again on the next
+ * update event.
+ *
+ * @param list  the list to redraw.
+ */
+static void emu_redraw(ListHandle list)
+{
+	GrafPtr old_port;
+	Rect r;
+
+	GetPort(&old_port);
+	SetPort((**list).port);
+	r = (**list).rView;
+	InvalRect(&r);
+	if ((**list).vScroll) {
+		r = (**((**list).vScroll)).contrlRect;
+		InvalRect(&r);
+	}
+	SetPort(old_port);
+}
+
+/**
+ * Parses a block of raw data from the SCSI device into sorted entries, pairing
+ * AppleDouble sidecars with their files.
+ *
+ * The data is read in one pass, turning names into Pascal strings and noting a sort
+ * key for each, folded with UprString() so case and diacriticals are ignored. Entries
+ * are then merge sorted on those keys.
+ *
+ * @param d        the listing data, which is modified.
+ * @param len      length of the above.
+ * @param offsets  set to a new block with the offset of each entry in sorted order,
+ *                 followed by the same number of sidecar markers: -1 for none, -2
+ *                 for a paired sidecar that is not shown, otherwise the entry number
+ *                 of the sidecar. Release with DisposPtr().
+ * @param shown    set to the number of entries that are not paired sidecars.
+ * @return         the number of entries.
+ */
+static short emu_parse(unsigned char *d, short len, short **offsets, short *shown)
+{
+	short rcnt, max, i, j, t;
+	unsigned char *k, *keys;
+	short *offs, *order, *side;
+	Str63 name;
+
+	/* reserve space for the most entries there could be */
+	max = len / 40;
+	if (max > MAXIMUM_FILES) max = MAXIMUM_FILES;
+	if (! (offs = (short *) NewPtr(max * 6L))) {
+		mem_fail();
+	}
+	order = offs + max;
+	if (! (keys = (unsigned char *) NewPtr(max * (long) EMU_KEY_SIZE))) {
+		mem_fail();
+	}
+
+	/* find the real entries, directories don't count, making each ready to sort */
+	rcnt = 0;
+	for (i = 0; i + 40 <= len && rcnt < max; i += 40) {
+		/* directory = 0, files = 1 */
+		if (! d[i+1]) continue;
+
+		/* make the name a Pascal string, falling back to max safe HFS name */
+		d[i+34] = '\0';
+		d[i+1] = 31;
+		for (j = 2; j < 33; j++) {
+			if (d[i+j] == '\0') {
+				d[i+1] = j - 2;
+				break;
+			}
+		}
+		/* cleanup instances of the HFS separator */
+		repl_chars(&(d[i+1]), ':', '/');
+		/* TODO more sensible sanitization would be prudent */
+
+		k = &(keys[rcnt * EMU_KEY_SIZE]);
+		BlockMove(&(d[i+1]), k, d[i+1] + 1);
+		UprString(k, false);
+
+		offs[rcnt] = i;
+		order[rcnt] = rcnt;
+		rcnt++;
+	}
+
+	/* sort by file name, then put the offsets in that order */
+	side = order + max;
+	emu_sort(order, side, rcnt, keys);
+	for (i = 0; i < rcnt; i++) {
+		side[i] = offs[order[i]];
+	}
+	BlockMove(side, offs, rcnt * 2L);
+	DisposPtr((Ptr) keys);
+
+	/*
+	 * Pair AppleDouble "._name" sidecars with the files they belong to. Paired
+	 * sidecars are hidden, and downloaded along with their file instead; see
+	 * emu_get_sidecar(). Sidecars without a file stay in the list.
+	 */
+	side = offs + rcnt;
+	*shown = rcnt;
+	names_clear(emu_names);
+	for (i = 0; i < rcnt; i++) {
+		side[i] = -1;
+		names_add(emu_names, &(d[offs[i]+1]), i);
+	}
+	for (i = 0; i < rcnt; i++) {
+		t = offs[i];
+		if (! adouble_is_sidecar(&(d[t+1]))) continue;
+		name[0] = d[t+1] - 2;
+		BlockMove(&(d[t+4]), &(name[1]), name[0]);
+		j = names_find(emu_names, name);
+		if (j >= 0 && side[j] == -1 && ! adouble_is_sidecar(&(d[offs[j]+1]))) {
+			side[j] = i;
+			side[i] = -2;
+			(*shown)--;
+		}
+	}
+	names_clear(emu_names);
+
+	*offsets = offs;
+	return rcnt;
+}
+
 /**
  * Parses a block of raw data from the SCSI device, inserting it into internal storage
  * /and/ the provided list for showing to the user.
@@ -188,111 +617,159 @@ Boolean emu_get_info(short item, short *index, long *size)
  * The format of this data is described in scsi.c. Input should be cleanly divisible by
  * 40; excess bytes will be discarded. This call will modify the data provided.
  *
- * This will clear any existing items.
+ * Normally this replaces every row, with drawing turned off and one redraw at the end.
+ * When asked to keep the rows, the new listing is instead compared by name against the
+ * rows already there, which are in the same order: rows for files that went away are
+ * removed, rows for new files are added, and rows whose file changed size or index are
+ * set again. Everything else is left alone, so selections stay put and only the rows
+ * that changed are drawn. peek.c is told about each change so the types it found stay
+ * with their rows.
  *
  * @param list      list to be updated.
  * @param data      data to be parsed, or NIL to clear list.
  * @param data_len  length of above data, or zero to clear list.
+ * @param keep      true to update the rows in place, false to replace them.
  * @return          the number of entries encountered.
  */
-short emu_populate_list(ListHandle list, Handle data, short data_len)
+short emu_populate_list(ListHandle list, Handle data, short data_len, Boolean keep)
 {
-	short dcnt, rcnt, i, j, t, min;
+	short rcnt, shown, old, row, a, i, t, c, len;
+	short oindex, osindex;
+	long osize, ossize;
 	Point p;
-	unsigned char *d;
-	short *offsets;
+	GrafPtr old_port;
+	unsigned char *d, *k, *okeys;
+	short *offsets, *side, *prev;
+	Handle nkeys;
+	char cell[32];
 
 	/* resolve condition where no data is available */
-	if (! (list && data && data_len > 40)) {
+	if (! (list && data && data_len >= 40)) {
 		emu_count = 0;
+		names_clear(emu_names);
+		SetHandleSize(emu_keys, 0);
 		if (list) {
 			LDelRow(0, 0, list);
 		}
+		peek_clear();
 		return 0;
 	}
 
 	HLock(data);
 	d = (unsigned char *) (*data);
-
-	/* delete all existing list rows */
-	LDelRow(0, 0, list);
-	emu_count = 0;
-
-	/* figure out how many real entries there are, directories don't count */
-	rcnt = 0;
-	for (i = 0; i < data_len; i += 40) {
-		/* directory = 0, files = 1 */
-		if (d[i+1]) {
-			rcnt++;
-
-			/* while we are here ensure string is null terminated */
-			d[i+34] = '\0';
+	rcnt = emu_parse(d, data_len, &offsets, &shown);
+	side = offsets + rcnt;
+
+	/* the old values are needed while the new ones are being stored */
+	old = (keep ? emu_count : 0);
+	if (old > 0) {
+		if (! (prev = (short *) NewPtr(old * 12L))) {
+			HUnlock(data);
+			mem_fail();
 		}
+		BlockMove(emu_index, prev, old * 2L);
+		BlockMove(emu_side_index, prev + old, old * 2L);
+		BlockMove(emu_sizes, prev + old * 2, old * 4L);
+		BlockMove(emu_side_sizes, prev + old * 4, old * 4L);
 	}
-
-	/* reserve space for tracking valid data offsets and list cells */
-	if (! (offsets = (short *) NewPtr(rcnt * 2))) {
+	if (! (nkeys = NewHandle(shown * (long) EMU_KEY_SIZE))) {
 		HUnlock(data);
 		mem_fail();
 	}
-	LAddRow(rcnt, 0, list);
-
-	/* find the data offset for each actual entry */
-	t = 0;
-	for (i = 0; i < data_len; i += 40) {
-		if (! (d[i+1])) continue;
-		offsets[t++] = i;
+	HLock(nkeys);
+	HLock(emu_keys);
+	okeys = (unsigned char *) *emu_keys;
+
+	GetPort(&old_port);
+	SetPort((**list).port);
+	if (old <= 0) {
+		/* replace all existing list rows without drawing each one */
+		LDoDraw(false, list);
+		LDelRow(0, 0, list);
+		LAddRow(shown, 0, list);
 	}
 
-	/* modify data to make names Pascal strings */
+	/* store data, and bring the list rows in line with it */
+	emu_count = 0;
+	a = 0;
 	for (i = 0; i < rcnt; i++) {
+		if (side[i] == -2) continue;
 		t = offsets[i];
-		d[t+1] = 31; /* fallback to max safe HFS name */
-		for (j = 2; j < 33; j++) {
-			if (d[t+j] == '\0') {
-				/* add Pascal length */
-				d[t+1] = j - 2;
-				break;
-			}
+		row = emu_count;
+
+		/* fetch values */
+		emu_index[row] = d[t];
+		emu_sizes[row] = be32(&(d[t + 36]));
+		if (side[i] >= 0) {
+			emu_side_index[row] = d[offsets[side[i]]];
+			emu_side_sizes[row] = be32(&(d[offsets[side[i]] + 36]));
+		} else {
+			emu_side_index[row] = -1;
+			emu_side_sizes[row] = 0;
 		}
-		/* cleanup instances of the HFS separator */
-		repl_chars(&(d[t+1]), ':', '/');
-		/* TODO more sensible sanitization would be prudent */
-	}
+		names_add(emu_names, &(d[t+1]), row);
+		k = (unsigned char *) *nkeys + row * EMU_KEY_SIZE;
+		BlockMove(&(d[t+1]), k, d[t+1] + 1);
+		UprString(k, false);
+		emu_count++;
 
-	/* sort by file name */
-	for (i = 0; i < rcnt - 1; i++) {
-		min = i;
-		for (j = i + 1; j < rcnt; j++) {
-			t = RelString(
-					&(d[offsets[j]+1]),
-					&(d[offsets[min]+1]),
-					false, false);
-			if (t < 0) min = j;
-		}
-		if (min != i) {
-			t = offsets[i];
-			offsets[i] = offsets[min];
-			offsets[min] = t;
+		SetPt(&p, 0, row);
+		if (old <= 0) {
+			LSetCell(&(d[t+2]), d[t+1], p, list);
+			continue;
 		}
-	}
 
-	/* store data */
-	for (i = 0; i < rcnt; i++) {
-		t = offsets[i];
+		/* rows before this name have no file any more */
+		c = -1;
+		while (a < old
+				&& (c = emu_key_cmp(&(okeys[a * EMU_KEY_SIZE]), k)) < 0) {
+			peek_shift(row, -1);
+			LDelRow(1, row, list);
+			a++;
+			c = -1;
+		}
 
-		/* insert filename into list */
-		SetPt(&p, 0, i);
-		LSetCell(&(d[t+2]), d[t+1], p, list);
+		if (a < old && c == 0) {
+			/* same file as before, only touch the row if something changed */
+			oindex = prev[a];
+			osindex = prev[old + a];
+			osize = ((long *) (prev + old * 2))[a];
+			ossize = ((long *) (prev + old * 4))[a];
+			len = sizeof(cell);
+			LGetCell(cell, &len, p, list);
+			if (oindex != emu_index[row] || osize != emu_sizes[row]
+					|| osindex != emu_side_index[row]
+					|| (osindex >= 0 && ossize != emu_side_sizes[row])
+					|| len != d[t+1] || ! str_eq(cell, (char *) &(d[t+2]), len)) {
+				peek_forget(row);
+				LSetCell(&(d[t+2]), d[t+1], p, list);
+			}
+			a++;
+		} else {
+			/* a new file */
+			peek_shift(row, 1);
+			LAddRow(1, row, list);
+			LSetCell(&(d[t+2]), d[t+1], p, list);
+		}
+	}
 
-		/* fetch remaining values */
-		emu_index[emu_count] = d[t];
-		emu_sizes[emu_count] = ((long) d[t+36] << 24)
-				+ ((long) d[t+37] << 16)
-				+ ((long) d[t+38] << 8)
-				+ (long) d[t+39];
-		emu_count++;
+	if (old <= 0) {
+		LDoDraw(true, list);
+		emu_redraw(list);
+	} else {
+		/* anything left at the end has no file any more either */
+		if (a < old) {
+			LDelRow(old - a, emu_count, list);
+		}
+		DisposPtr((Ptr) prev);
 	}
+	SetPort(old_port);
+
+	/* the new keys are compared against next time */
+	HUnlock(emu_keys);
+	DisposHandle(emu_keys);
+	HUnlock(nkeys);
+	emu_keys = nkeys;
 
 	DisposPtr((Ptr) offsets);
 	HUnlock(data);
@@ -309,13 +786,25 @@ void emu_mount(short scsi_id)
 {
 	short item, index;
 	long err;
+	Str63 name;
 
 	item = 0;
 	window_next(&item);
 
 	if (item >= 0 && item < emu_count) {
 		index = emu_index[item];
-		if (err = scsi_set_image(scsi_id, index)) {
+		err = scsi_set_image(scsi_id, index);
+		if (scsi_is_attention(err)) {
+			/* device was reset, image indexes may have changed */
+			window_get_item_name(item, name);
+			if (! emu_recover(scsi_id, 1)) return;
+			if (! emu_find(name, &item)) {
+				alert_template(0, ALRT_GENERIC, STRI_GA_NSI);
+				return;
+			}
+			err = scsi_set_image(scsi_id, emu_index[item]);
+		}
+		if (err) {
 			scsi_alert(err);
 		} else {
 			emu_eject(scsi_id);
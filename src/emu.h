@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2024 saybur
+ * Copyright (C) 2024-2026 saybur
  *
  * This program is free software: you can redistribute it and/or modify it under the
  * terms of the GNU General Public License as published by the Free Software
@@ -20,7 +20,13 @@
 void emu_init(void);
 short emu_get_count(void);
 Boolean emu_get_info(short item, short *index, long* size);
-short emu_populate_list(ListHandle list, Handle data, short length);
+Boolean emu_get_sidecar(short item, short *index, long *size);
+Boolean emu_find(unsigned char *name, short *item);
+long emu_list(short scsi_id, short open_type, short *count);
+long emu_list_cached(short scsi_id, short open_type, short *count);
+long emu_watch(short scsi_id, short open_type, Boolean *changed);
+Boolean emu_recover(short scsi_id, short open_type);
+short emu_populate_list(ListHandle list, Handle data, short length, Boolean keep);
 void emu_mount(short scsi_id);
 
 #endif /* __EMUH__ */
@@ -0,0 +1,269 @@
+/*
+ * Copyright (C) 2026 saybur
+ *
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this
+ * program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "fork.h"
+
+/*
+ * This compilation unit writes local files that may have both a data and resource
+ * fork, for anything that produces complete Macintosh files from what is on the
+ * device: plain downloads, and files decoded from archive formats on the way in.
+ *
+ * One file is written at a time. It is created with the right type and creator, the
+ * forks are written in whatever order the source provides them, and any remaining
+ * Finder information and dates are applied once the forks are closed so the File
+ * Manager does not overwrite them.
+ */
+
+/* Finder flags that describe a file's state on another machine, not its nature */
+#define FORK_FLAGS_CLEAR  0x0701 /* on desk, inited, changed, busy */
+
+static ForkInfo out;
+static short out_vref, dref, rref;
+static Boolean dopen, ropen;
+
+/**
+ * Preallocates space in an open fork, contiguously if the volume has room for that.
+ * Besides keeping the file from fragmenting this saves the File Manager from growing
+ * the fork on every write.
+ *
+ * @param ref  the open fork.
+ * @param len  the number of bytes to reserve.
+ * @return     zero on success, otherwise the OSErr.
+ */
+static short fork_alloc(short ref, long len)
+{
+	long count;
+
+	if (len <= 0) return 0;
+
+	/* if contiguous space isn't available SetEOF will take any */
+	count = len;
+	AllocContig(ref, &count);
+	return SetEOF(ref, len);
+}
+
+/**
+ * Opens the resource fork of the current file, preallocating it if requested.
+ *
+ * @return  zero on success, otherwise the OSErr.
+ */
+static short fork_open_rsrc(void)
+{
+	short err;
+
+	if (err = OpenRF(out.name, out_vref, &rref)) {
+		return err;
+	}
+	ropen = true;
+	return fork_alloc(rref, out.rlen);
+}
+
+/**
+ * Creates a new file and opens it for writing. The data fork is always opened; the
+ * resource fork is opened when first written or right away if space is to be
+ * preallocated for it.
+ *
+ * If the file is created but cannot be opened or preallocated it is deleted again.
+ *
+ * @param info     the file to create. This is copied, the caller need not keep it.
+ * @param vref     the volume or working directory to create the file in.
+ * @param replace  true to delete any existing file with the same name first.
+ * @return         zero on success, otherwise the OSErr. dupFNErr is returned if the
+ *                 file exists and replace is false.
+ */
+short fork_create(ForkInfo *info, short vref, Boolean replace)
+{
+	short err;
+
+	if (dopen || ropen) return opWrErr;
+
+	BlockMove(info, &out, sizeof(ForkInfo));
+	out_vref = vref;
+
+	if (err = Create(out.name, vref, out.creator, out.type)) {
+		if (! (err == dupFNErr && replace)) {
+			return err;
+		}
+
+		/* handle by deleting existing file and trying creation again */
+		if (err = FSDelete(out.name, vref)) {
+			return err;
+		}
+		if (err = Create(out.name, vref, out.creator, out.type)) {
+			return err;
+		}
+	}
+
+	if (err = FSOpen(out.name, vref, &dref)) {
+		FSDelete(out.name, vref);
+		return err;
+	}
+	dopen = true;
+
+	if (! (err = fork_alloc(dref, out.dlen))) {
+		if (out.rlen > 0) {
+			err = fork_open_rsrc();
+		}
+	}
+	if (err) {
+		fork_abort();
+	}
+	return err;
+}
+
+/**
+ * Writes data to the end of one of the forks of the current file.
+ *
+ * @param fork  FORK_DATA or FORK_RSRC.
+ * @param data  the data to write.
+ * @param len   the number of bytes to write.
+ * @return      zero on success, otherwise the OSErr.
+ */
+short fork_write(short fork, char *data, long len)
+{
+	short err;
+
+	if (len <= 0) return 0;
+
+	if (fork == FORK_RSRC) {
+		if (! ropen) {
+			if (! dopen) return fnOpnErr;
+			if (err = fork_open_rsrc()) return err;
+		}
+		return FSWrite(rref, &len, data);
+	} else {
+		if (! dopen) return fnOpnErr;
+		return FSWrite(dref, &len, data);
+	}
+}
+
+/**
+ * Replaces the Finder information and dates to be applied to the current file when
+ * it is closed, for sources that provide these after the file is created. The name
+ * and fork sizes are not changed.
+ *
+ * @param info  the new information, used if its set_info is true.
+ */
+void fork_set_info(ForkInfo *info)
+{
+	if (! info->set_info) return;
+
+	out.type = info->type;
+	out.creator = info->creator;
+	out.flags = info->flags;
+	out.crdate = info->crdate;
+	out.mddate = info->mddate;
+	out.set_info = true;
+}
+
+/**
+ * Trims a fork to the amount that was written, in case less arrived than was
+ * preallocated, then closes it. Forks that were not preallocated already end where
+ * the writes stopped, so those are just closed.
+ *
+ * @param ref  the open fork.
+ * @param len  the length the fork was preallocated to, or zero.
+ * @return     zero on success, otherwise the OSErr.
+ */
+static short fork_finish(short ref, long len)
+{
+	short err;
+	long pos;
+
+	err = 0;
+	if (len > 0 && ! (err = GetFPos(ref, &pos))) {
+		err = SetEOF(ref, pos);
+	}
+	if (err) {
+		FSClose(ref);
+		return err;
+	}
+	return FSClose(ref);
+}
+
+/**
+ * Closes the current file and applies the remaining Finder information and dates, if
+ * any were given. If anything goes wrong the file is deleted, so a file left behind
+ * is always complete.
+ *
+ * @return  zero on success, otherwise the OSErr.
+ */
+short fork_close(void)
+{
+	ParamBlockRec pb;
+	short err, rerr;
+
+	if (! dopen) return fnOpnErr;
+
+	dopen = false;
+	err = fork_finish(dref, out.dlen);
+	if (ropen) {
+		ropen = false;
+		rerr = fork_finish(rref, out.rlen);
+		if (! err) err = rerr;
+	}
+
+	if (! err && out.set_info) {
+		pb.fileParam.ioCompletion = 0;
+		pb.fileParam.ioNamePtr = out.name;
+		pb.fileParam.ioVRefNum = out_vref;
+		pb.fileParam.ioFVersNum = 0;
+		pb.fileParam.ioFDirIndex = 0;
+		if (! (err = PBGetFInfo(&pb, false))) {
+			pb.fileParam.ioFlFndrInfo.fdType = out.type;
+			pb.fileParam.ioFlFndrInfo.fdCreator = out.creator;
+			pb.fileParam.ioFlFndrInfo.fdFlags = out.flags & ~FORK_FLAGS_CLEAR;
+			pb.fileParam.ioFlFndrInfo.fdLocation.h = 0;
+			pb.fileParam.ioFlFndrInfo.fdLocation.v = 0;
+			pb.fileParam.ioFlFndrInfo.fdFldr = 0;
+			if (out.crdate) pb.fileParam.ioFlCrDat = out.crdate;
+			if (out.mddate) pb.fileParam.ioFlMdDat = out.mddate;
+			err = PBSetFInfo(&pb, false);
+		}
+	}
+
+	if (err) {
+		FSDelete(out.name, out_vref);
+	}
+	return err;
+}
+
+/**
+ * Closes and deletes the current file, if one is open. Used to get rid of partial
+ * files after an error or cancellation.
+ */
+void fork_abort(void)
+{
+	if (! (dopen || ropen)) return;
+
+	if (dopen) {
+		FSClose(dref);
+		dopen = false;
+	}
+	if (ropen) {
+		FSClose(rref);
+		ropen = false;
+	}
+	FSDelete(out.name, out_vref);
+}
+
+/**
+ * @return  true if a file is currently open for writing.
+ */
+Boolean fork_is_open(void)
+{
+	return dopen;
+}
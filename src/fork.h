@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2026 saybur
+ *
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this
+ * program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __FORKH__
+#define __FORKH__
+
+#define FORK_DATA  0
+#define FORK_RSRC  1
+
+/* returned by decoders feeding this module when their source data is damaged */
+#define FORK_BAD_DATA  1
+
+typedef struct {
+	Str63 name;
+	long type;
+	long creator;
+	Boolean set_info;       /* if true, flags and dates below are applied on close */
+	short flags;
+	unsigned long crdate;   /* zero leaves the date as the File Manager set it */
+	unsigned long mddate;
+	long dlen;              /* bytes to preallocate in each fork, may be zero */
+	long rlen;
+} ForkInfo;
+
+short fork_create(ForkInfo *info, short vref, Boolean replace);
+short fork_write(short fork, char *data, long len);
+void fork_set_info(ForkInfo *info);
+short fork_close(void);
+void fork_abort(void);
+Boolean fork_is_open(void);
+
+#endif /* __FORKH__ */
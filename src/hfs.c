@@ -0,0 +1,538 @@
+/*
+ * Copyright (C) 2026 saybur
+ *
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this
+ * program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "hfs.h"
+#include "util.h"
+
+/*
+ * This compilation unit reads the catalog of an HFS volume inside a disk image on the
+ * device. Only the parts needed are read: the partition map if there is one, the
+ * master directory block, and the nodes of the catalog B-tree on the way down to
+ * the directory being listed. The extents overflow B-tree is searched the same way
+ * when a fork has more than three extents. Everything is addressed by allocation
+ * block within the volume, which is turned into an offset in the image for
+ * image_read().
+ *
+ * See Inside Macintosh: Files, chapter 2, for the structures used here.
+ */
+
+#define HFS_SIG_MDB       0x4244  /* 'BD' */
+#define HFS_SIG_PLUS      0x482B  /* 'H+', embedded HFS Plus is not supported */
+#define HFS_SIG_DDM       0x4552  /* 'ER', driver descriptor map */
+#define HFS_SIG_PART      0x504D  /* 'PM', partition map entry */
+#define HFS_DC42_MAGIC    0x0100  /* end of a Disk Copy 4.2 header */
+#define HFS_DC42_SIZE     84
+
+#define HFS_SECTOR        512L
+#define HFS_NODE_SIZE     512
+#define HFS_MAX_PARTS     64
+
+#define HFS_ID_ROOT       2
+#define HFS_ID_EXTENTS    3
+#define HFS_ID_CATALOG    4
+
+#define HFS_NODE_INDEX    0x00
+#define HFS_NODE_LEAF     0xFF
+
+#define HFS_REC_DIR       1
+#define HFS_REC_FILE      2
+#define HFS_REC_DTHREAD   3
+
+typedef struct {
+	long id;
+	unsigned short ext[6];
+	long root;
+	long nodes;
+} HfsTree;
+
+static long ablk_size, ablk_start;
+static HfsTree xtree, ctree;
+
+/* what hfs_cmp() compares keys against */
+static Boolean tcat;
+static long tid;
+static short tfork;
+
+/* the last extents overflow record found, see hfs_fork_map() */
+static Boolean ovalid;
+static long oid;
+static short ofork;
+static unsigned short oabn, oext[6];
+
+static long hfs_node(HfsTree *t, long n, unsigned char *node);
+static long hfs_find(HfsTree *t, unsigned char *node, long *n);
+
+/**
+ * Reads an extent record of three start/count pairs.
+ */
+static void hfs_extents(unsigned char *p, unsigned short *ext)
+{
+	short i;
+
+	for (i = 0; i < 6; i++) {
+		ext[i] = be16(p + i * 2);
+	}
+}
+
+/**
+ * Looks for an allocation block of a fork within one extent record.
+ *
+ * @param ext  the extent record.
+ * @param abn  the fork allocation block the record starts at.
+ * @param ab   the fork allocation block wanted.
+ * @param pos  the fork offset wanted.
+ * @param off  set to the image offset of pos.
+ * @param run  set to how many bytes are contiguous from there.
+ * @return     true if the record holds the block.
+ */
+static Boolean hfs_ext_find(unsigned short *ext, long abn, long ab, long pos,
+		long *off, long *run)
+{
+	short i;
+	long rel;
+
+	for (i = 0; i < 3 && ext[i * 2 + 1]; i++) {
+		if (ab < abn + ext[i * 2 + 1]) {
+			rel = ab - abn;
+			*off = ablk_start + ((long) ext[i * 2] + rel) * ablk_size + pos % ablk_size;
+			*run = ((long) ext[i * 2 + 1] - rel) * ablk_size - pos % ablk_size;
+			return true;
+		}
+		abn += ext[i * 2 + 1];
+	}
+	return false;
+}
+
+/**
+ * Compares a leaf key with the target set in tcat, tid and tfork. Catalog keys are
+ * grouped by parent directory; extents keys by file number, then fork.
+ *
+ * @param key  the key.
+ * @return     negative if the key comes before the target group, zero if it is in
+ *             the group, positive if after.
+ */
+static short hfs_cmp(unsigned char *key)
+{
+	long id;
+	short fork;
+
+	if (tcat) {
+		id = be32(key + 2);
+		return (id < tid ? -1 : (id > tid ? 1 : 0));
+	}
+
+	id = be32(key + 2);
+	if (id != tid) {
+		return (id < tid ? -1 : 1);
+	}
+	fork = (key[1] == 0xFF ? FORK_RSRC : FORK_DATA);
+	return fork - tfork;
+}
+
+/**
+ * Works out where in the image a fork offset is, using the first extent record and
+ * then the extents overflow file. The search target used by hfs_cmp() is kept, as
+ * this is called while walking the catalog.
+ *
+ * @param ext   the first extent record of the fork.
+ * @param id    the file number.
+ * @param fork  FORK_DATA or FORK_RSRC.
+ * @param pos   the offset within the fork.
+ * @param off   set to the offset within the image.
+ * @param run   set to how many bytes are contiguous from there.
+ * @return      zero on success, IMAGE_BAD_DATA if the extents do not cover the
+ *              offset, otherwise the error from reading.
+ */
+static long hfs_fork_map(unsigned short *ext, long id, short fork, long pos,
+		long *off, long *run)
+{
+	unsigned char *node, *key;
+	long ab, n, err, sid, visits;
+	short r, nrecs, roff, doff, c, sfork;
+	Boolean found, scat;
+
+	ab = pos / ablk_size;
+	if (hfs_ext_find(ext, 0, ab, pos, off, run)) {
+		return 0;
+	}
+	if (ovalid && oid == id && ofork == fork
+			&& hfs_ext_find(oext, oabn, ab, pos, off, run)) {
+		return 0;
+	}
+	if (id == HFS_ID_EXTENTS) {
+		/* the extents file cannot have overflow records of its own */
+		return IMAGE_BAD_DATA;
+	}
+
+	if (! (node = (unsigned char *) NewPtr(HFS_NODE_SIZE))) {
+		mem_fail();
+	}
+
+	/* search the overflow file, keeping the record that matched */
+	scat = tcat;
+	sid = tid;
+	sfork = tfork;
+	tcat = false;
+	tid = id;
+	tfork = fork;
+	found = false;
+	c = 0;
+	visits = 0;
+	err = hfs_find(&xtree, node, &n);
+	while (! err && ! found && c <= 0) {
+		nrecs = be16(node + 10);
+		for (r = 0; r < nrecs && ! found && c <= 0; r++) {
+			roff = be16(node + HFS_NODE_SIZE - 2 * (r + 1));
+			if (roff < 14 || roff > HFS_NODE_SIZE - 20) continue;
+			key = node + roff;
+			if (key[0] < 7) continue;
+			if ((c = hfs_cmp(key)) < 0) continue;
+			if (c > 0) break;
+
+			doff = roff + 1 + key[0];
+			if (doff & 1) doff++;
+			ovalid = true;
+			oid = id;
+			ofork = fork;
+			oabn = be16(key + 6);
+			hfs_extents(node + doff, oext);
+			found = hfs_ext_find(oext, oabn, ab, pos, off, run);
+		}
+		if (found || c > 0 || ! (n = be32(node))) break;
+		if (++visits >= xtree.nodes) {
+			/* a loop in the chain */
+			err = IMAGE_BAD_DATA;
+			break;
+		}
+		err = hfs_node(&xtree, n, node);
+	}
+
+	DisposPtr((Ptr) node);
+	tcat = scat;
+	tid = sid;
+	tfork = sfork;
+	if (err) return err;
+	return found ? 0 : IMAGE_BAD_DATA;
+}
+
+/**
+ * Reads a node of a B-tree file.
+ *
+ * @param t     the B-tree.
+ * @param n     the node number.
+ * @param node  where to put the node.
+ * @return      zero on success, otherwise the error from reading.
+ */
+static long hfs_node(HfsTree *t, long n, unsigned char *node)
+{
+	long off, run, err;
+
+	if (n < 0 || n >= t->nodes) {
+		return IMAGE_BAD_DATA;
+	}
+	if (err = hfs_fork_map(t->ext, t->id, FORK_DATA, n * HFS_NODE_SIZE, &off, &run)) {
+		return err;
+	}
+	return image_read(off, (char *) node, HFS_NODE_SIZE);
+}
+
+/**
+ * Searches a B-tree for the leaf node where the target group set for hfs_cmp()
+ * would start. The group may begin in a later leaf, so callers follow the forward
+ * links until keys come after the group.
+ *
+ * @param t     the B-tree.
+ * @param node  a buffer for a node, which holds the leaf on return.
+ * @param n     set to the leaf node number.
+ * @return      zero on success, otherwise the error from reading.
+ */
+static long hfs_find(HfsTree *t, unsigned char *node, long *n)
+{
+	long child, err;
+	short r, nrecs, roff, doff, depth;
+
+	*n = t->root;
+	for (depth = 0; depth < 8; depth++) {
+		if (err = hfs_node(t, *n, node)) {
+			return err;
+		}
+		if (node[8] == HFS_NODE_LEAF) {
+			return 0;
+		}
+		if (node[8] != HFS_NODE_INDEX) {
+			return IMAGE_BAD_DATA;
+		}
+
+		/* follow the last record that comes before the group */
+		child = -1;
+		nrecs = be16(node + 10);
+		for (r = 0; r < nrecs; r++) {
+			roff = be16(node + HFS_NODE_SIZE - 2 * (r + 1));
+			if (roff < 14 || roff > HFS_NODE_SIZE - 20) continue;
+			doff = roff + 1 + node[roff];
+			if (doff & 1) doff++;
+			if (child >= 0 && hfs_cmp(node + roff) >= 0) break;
+			child = be32(node + doff);
+		}
+		if (child < 0) {
+			return IMAGE_BAD_DATA;
+		}
+		*n = child;
+	}
+	return IMAGE_BAD_DATA;
+}
+
+/**
+ * Reads the header node of a B-tree file.
+ *
+ * @param t     the B-tree, with the file number and extents already set.
+ * @param node  a buffer for a node.
+ * @return      zero on success, otherwise the error from reading.
+ */
+static long hfs_tree_open(HfsTree *t, unsigned char *node)
+{
+	long off, run, err;
+
+	if (err = hfs_fork_map(t->ext, t->id, FORK_DATA, 0, &off, &run)) {
+		return err;
+	}
+	if (err = image_read(off, (char *) node, HFS_NODE_SIZE)) {
+		return err;
+	}
+	if (be16(node + 32) != HFS_NODE_SIZE) {
+		return IMAGE_BAD_DATA;
+	}
+	t->root = be32(node + 16);
+	t->nodes = be32(node + 36);
+	return 0;
+}
+
+/**
+ * Makes an entry from a catalog leaf record.
+ *
+ * @param key   the key of the record.
+ * @param data  the record.
+ * @param e     set to the entry.
+ * @return      true for folders and files, false for other records.
+ */
+static Boolean hfs_entry(unsigned char *key, unsigned char *data, ImageEntry *e)
+{
+	short len;
+
+	e->parent = be32(key + 2);
+	len = key[6];
+	if (len > 31) len = 31;
+	BlockMove(key + 7, &(e->name[1]), len);
+	e->name[0] = len;
+
+	if (data[0] == HFS_REC_DIR) {
+		e->folder = true;
+		e->id = be32(data + 6);
+		e->type = 0;
+		e->creator = 0;
+		e->flags = 0;
+		e->crdate = be32(data + 10);
+		e->mddate = be32(data + 14);
+		e->dlen = 0;
+		e->rlen = 0;
+	} else if (data[0] == HFS_REC_FILE) {
+		e->folder = false;
+		e->type = be32(data + 4);
+		e->creator = be32(data + 8);
+		e->flags = be16(data + 12);
+		e->id = be32(data + 20);
+		e->dlen = be32(data + 26);
+		e->rlen = be32(data + 36);
+		e->crdate = be32(data + 44);
+		e->mddate = be32(data + 48);
+		hfs_extents(data + 74, e->ext[FORK_DATA]);
+		hfs_extents(data + 86, e->ext[FORK_RSRC]);
+	} else {
+		return false;
+	}
+	return true;
+}
+/**
+ * Checks if the image holds an HFS volume, either on its own, as the first HFS
+ * partition of a partitioned disk, or inside a Disk Copy 4.2 image.
+ *
+ * @param voff  set to the offset of the volume within the image, or -1 if there is
+ *              no HFS volume.
+ * @return      zero on success, otherwise the error from reading.
+ */
+long hfs_probe(long *voff)
+{
+	unsigned char buf[HFS_SECTOR];
+	long err, i, parts;
+
+	*voff = -1;
+	if (err = image_read(0, (char *) buf, HFS_SECTOR)) {
+		return (err == IMAGE_BAD_DATA ? 0 : err);
+	}
+
+	if (be16(buf) == HFS_SIG_DDM) {
+		/* find the first HFS partition in the map */
+		parts = 1;
+		for (i = 1; i <= parts && i <= HFS_MAX_PARTS; i++) {
+			if (err = image_read(i * HFS_SECTOR, (char *) buf, HFS_SECTOR)) {
+				return (err == IMAGE_BAD_DATA ? 0 : err);
+			}
+			if (be16(buf) != HFS_SIG_PART) break;
+			parts = be32(buf + 4);
+			if (str_eq((char *) buf + 48, "Apple_HFS", 10)) {
+				*voff = be32(buf + 8) * HFS_SECTOR;
+				break;
+			}
+		}
+		if (*voff < 0) return 0;
+	} else if (buf[0] < 64 && be16(buf + 82) == HFS_DC42_MAGIC) {
+		*voff = HFS_DC42_SIZE;
+	} else {
+		*voff = 0;
+	}
+
+	/* check the master directory block */
+	if (err = image_read(*voff + 2 * HFS_SECTOR, (char *) buf, 128)) {
+		*voff = -1;
+		return (err == IMAGE_BAD_DATA ? 0 : err);
+	}
+	if (be16(buf) != HFS_SIG_MDB || be16(buf + 124) == HFS_SIG_PLUS) {
+		*voff = -1;
+	}
+	return 0;
+}
+
+/**
+ * Reads the master directory block and the B-tree headers of the HFS volume.
+ *
+ * @param voff  the offset of the volume within the image, from hfs_probe().
+ * @return      zero on success, otherwise the error from reading.
+ */
+long hfs_load(long voff)
+{
+	unsigned char mdb[162];
+	unsigned char *node;
+	long err;
+
+	if (err = image_read(voff + 2 * HFS_SECTOR, (char *) mdb, sizeof(mdb))) {
+		return err;
+	}
+	ablk_size = be32(mdb + 20);
+	ablk_start = voff + be16(mdb + 28) * HFS_SECTOR;
+	if (ablk_size < HFS_SECTOR || ablk_size % HFS_SECTOR) {
+		return IMAGE_BAD_DATA;
+	}
+	xtree.id = HFS_ID_EXTENTS;
+	hfs_extents(mdb + 134, xtree.ext);
+	ctree.id = HFS_ID_CATALOG;
+	hfs_extents(mdb + 150, ctree.ext);
+	ovalid = false;
+
+	if (! (node = (unsigned char *) NewPtr(HFS_NODE_SIZE))) {
+		mem_fail();
+	}
+	if (! (err = hfs_tree_open(&xtree, node))) {
+		err = hfs_tree_open(&ctree, node);
+	}
+	DisposPtr((Ptr) node);
+
+	image_set_root(HFS_ID_ROOT);
+	return err;
+}
+
+/**
+ * Lists a directory into the image entry table. The catalog is searched for the
+ * thread record of the directory, which gives its name and parent, and the records
+ * for its contents follow it in key order.
+ *
+ * @param dir  the directory ID.
+ * @return     zero on success, otherwise the error from reading.
+ */
+long hfs_list(long dir)
+{
+	unsigned char *node, *key, *data;
+	ImageEntry e;
+	long n, visits, err;
+	short r, nrecs, roff, doff, c;
+
+	if (! (node = (unsigned char *) NewPtr(HFS_NODE_SIZE))) {
+		mem_fail();
+	}
+
+	tcat = true;
+	tid = dir;
+	c = 0;
+	visits = 0;
+	err = hfs_find(&ctree, node, &n);
+	while (! err) {
+		if (node[8] != HFS_NODE_LEAF) {
+			err = IMAGE_BAD_DATA;
+			break;
+		}
+
+		nrecs = be16(node + 10);
+		for (r = 0; r < nrecs; r++) {
+			roff = be16(node + HFS_NODE_SIZE - 2 * (r + 1));
+			if (roff < 14 || roff > HFS_NODE_SIZE - 20) continue;
+			key = node + roff;
+			if (key[0] < 6) continue;
+			if ((c = hfs_cmp(key)) < 0) continue;
+			if (c > 0) break;
+
+			doff = roff + 1 + key[0];
+			if (doff & 1) doff++;
+			data = node + doff;
+
+			/* thread records are 46 bytes, folders 70, and files 102 */
+			if (doff + 46 > HFS_NODE_SIZE) continue;
+			if (data[0] == HFS_REC_DIR && doff + 70 > HFS_NODE_SIZE) continue;
+			if (data[0] == HFS_REC_FILE && doff + 102 > HFS_NODE_SIZE) continue;
+			if (data[0] == HFS_REC_DTHREAD) {
+				image_set_dir(dir, be32(data + 10), data + 14);
+			} else if (hfs_entry(key, data, &e) && ! image_add(&e)) {
+				/* table is full, show what fit */
+				c = 1;
+				break;
+			}
+		}
+
+		if (c > 0 || ! (n = be32(node))) break;
+		if (++visits >= ctree.nodes) {
+			/* a loop in the chain */
+			err = IMAGE_BAD_DATA;
+			break;
+		}
+		err = hfs_node(&ctree, n, node);
+	}
+
+	DisposPtr((Ptr) node);
+	return err;
+}
+
+/**
+ * Works out where in the image part of a file is.
+ *
+ * @param e       the file.
+ * @param fork    FORK_DATA or FORK_RSRC.
+ * @param pos     the offset within the fork.
+ * @param offset  set to the offset within the image.
+ * @param run     set to how many bytes are contiguous from there.
+ * @return        zero on success, otherwise IMAGE_BAD_DATA.
+ */
+long hfs_map(ImageEntry *e, short fork, long pos, long *offset, long *run)
+{
+	return hfs_fork_map(e->ext[fork], e->id, fork, pos, offset, run);
+}
@@ -0,0 +1,27 @@
+/*
+ * Copyright (C) 2026 saybur
+ *
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this
+ * program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __HFSH__
+#define __HFSH__
+
+#include "image.h"
+
+long hfs_probe(long *voff);
+long hfs_load(long voff);
+long hfs_list(long dir);
+long hfs_map(ImageEntry *e, short fork, long pos, long *offset, long *run);
+
+#endif /* __HFSH__ */
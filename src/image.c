@@ -0,0 +1,611 @@
+/*
+ * Copyright (C) 2026 saybur
+ *
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this
+ * program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include "constants.h"
+#include "emu.h"
+#include "hfs.h"
+#include "image.h"
+#include "iso.h"
+#include "scsi.h"
+#include "types.h"
+#include "util.h"
+#include "zip.h"
+
+/*
+ * This compilation unit gives access to the contents of a disk image on the device
+ * without downloading it. Reads are made with the 0xD1 file read at whatever offset
+ * is needed. Small reads, which are the filesystem metadata, go through a cache of
+ * 4K blocks that keeps the most recently used, as the same directory and B-tree
+ * blocks are read over and over while browsing. Larger reads are for file contents
+ * and go through a separate window of consecutive blocks so they do not push the
+ * metadata out. The filesystem code fills in a table with the entries of one
+ * directory at a time, so memory use does not depend on the size of the volume.
+ * ZIP archives are browsed the same way, with their members standing in for files.
+ */
+
+/* blocks kept for metadata, and blocks read at once for file contents */
+#define IMAGE_SLOTS       8
+#define IMAGE_WINDOW      8
+
+/* entries are added to the table this many at a time, up to the maximum */
+#define IMAGE_GROW        64
+#define IMAGE_MAX_ENTRIES 512
+
+/* size of each read while extracting a file */
+#define IMAGE_COPY_SIZE   32768L
+
+static Boolean iopen;
+static short scsi_id, findex, kind;
+static long fsize, hoff;
+
+/* recently used blocks, with the tick each was last used */
+static Handle slots;
+static long sblk[IMAGE_SLOTS];
+static unsigned long sused[IMAGE_SLOTS], stick;
+
+/* consecutive blocks from the image, starting at cblk */
+static Handle cache;
+static long cblk, ccnt;
+
+static Handle entries;
+static long ecount, ealloc;
+static long root, dir, dparent;
+static Str31 dname;
+
+/**
+ * Shows an appropriate alert when a file error occurs.
+ *
+ * @param err the OSErr triggering the alert.
+ */
+static void image_alert_ferr(short err)
+{
+	short esi;
+
+	/* get appropriate STR# index for osErr */
+	esi = (err + 31) * -1;
+	if (esi < 1 || esi > 30) {
+		esi = 1;
+	}
+
+	alert_template_error(0, ALRT_FILE_ERROR, esi, err);
+}
+
+/**
+ * Reads consecutive blocks from the image.
+ *
+ * @param blk   the first 4K block to read.
+ * @param want  how many blocks are wanted; fewer may be read.
+ * @param dst   where to put the data, with room for all the blocks wanted.
+ * @param got   set to the number of blocks read.
+ * @return      zero on success, otherwise the SCSI fail code.
+ */
+static long image_fetch(long blk, long want, char *dst, short *got)
+{
+	long full;
+
+	full = fsize / IMAGE_BLK_SIZE;
+	if (blk >= full) {
+		/* partial block at the end of the image */
+		*got = 1;
+		return scsi_read_file_bytes(scsi_id, findex, blk, dst,
+				(short) (fsize - blk * IMAGE_BLK_SIZE));
+	}
+
+	if (blk + want > full) want = full - blk;
+	*got = (short) want;
+	if (*got > 1 && config_has_capability(scsi_id, CAP_LARGE_RECEIVE)) {
+		return scsi_read_file_blocks(scsi_id, findex, blk, dst, got);
+	}
+	*got = 1;
+	return scsi_read_file_bytes(scsi_id, findex, blk, dst, (short) IMAGE_BLK_SIZE);
+}
+
+/**
+ * Finds a block in the metadata cache, reading it into the least recently used slot
+ * if it is not there.
+ *
+ * @param blk   the 4K block.
+ * @param slot  set to the slot holding the block.
+ * @return      zero on success, otherwise the SCSI fail code.
+ */
+static long image_slot(long blk, short *slot)
+{
+	long err;
+	short i, got;
+
+	*slot = 0;
+	for (i = 0; i < IMAGE_SLOTS; i++) {
+		if (sblk[i] == blk) {
+			*slot = i;
+			sused[i] = ++stick;
+			return 0;
+		}
+		if (sused[i] < sused[*slot]) {
+			*slot = i;
+		}
+	}
+
+	i = *slot;
+	HLock(slots);
+	err = image_fetch(blk, 1, *slots + i * IMAGE_BLK_SIZE, &got);
+	HUnlock(slots);
+	if (err) {
+		sblk[i] = -1;
+		sused[i] = 0;
+		return err;
+	}
+	sblk[i] = blk;
+	sused[i] = ++stick;
+	return 0;
+}
+
+/**
+ * Reads blocks from the image into the window, replacing what was there.
+ *
+ * @param blk   the first 4K block to read.
+ * @param want  how many blocks are wanted; fewer may be read.
+ * @return      zero on success, otherwise the SCSI fail code.
+ */
+static long image_fill(long blk, long want)
+{
+	long err;
+	short got;
+
+	ccnt = 0;
+	if (want > IMAGE_WINDOW) want = IMAGE_WINDOW;
+
+	HLock(cache);
+	err = image_fetch(blk, want, *cache, &got);
+	HUnlock(cache);
+
+	if (! err) {
+		cblk = blk;
+		ccnt = got;
+	}
+	return err;
+}
+
+/**
+ * Opens a disk image from the file list for browsing. The image is checked for a
+ * supported filesystem and the top directory is listed into the entry table. Any
+ * problem is reported to the user before returning.
+ *
+ * @param scsi  the SCSI ID of the device.
+ * @param item  the item in the file list.
+ * @return      true if the image is open, false otherwise.
+ */
+Boolean image_open(short scsi, short item)
+{
+	long voff, err;
+	short i;
+
+	image_close();
+	if (! emu_get_info(item, &findex, &fsize)) {
+		alert_template(0, ALRT_GENERIC, STRI_GA_NSF);
+		return false;
+	}
+
+	if (! (cache = NewHandle(IMAGE_WINDOW * IMAGE_BLK_SIZE))) {
+		mem_fail();
+	}
+	if (! (slots = NewHandle(IMAGE_SLOTS * IMAGE_BLK_SIZE))) {
+		mem_fail();
+	}
+	for (i = 0; i < IMAGE_SLOTS; i++) {
+		sblk[i] = -1;
+		sused[i] = 0;
+	}
+	stick = 0;
+	if (! (entries = NewHandle(0))) {
+		mem_fail();
+	}
+	scsi_id = scsi;
+	kind = IMAGE_NONE;
+	ccnt = 0;
+	ecount = 0;
+	ealloc = 0;
+	root = 0;
+	dir = 0;
+	dparent = 0;
+	dname[0] = 0;
+	iopen = true;
+
+	busy_cursor();
+	if (err = hfs_probe(&voff)) {
+		goto image_open_fail;
+	}
+	if (voff >= 0) {
+		kind = IMAGE_HFS;
+		hoff = voff;
+		err = hfs_load(voff);
+	} else {
+		if (err = iso_probe(&voff)) {
+			goto image_open_fail;
+		}
+		if (voff >= 0) {
+			kind = IMAGE_ISO;
+			err = iso_load(voff);
+		} else {
+			if (err = zip_probe(&voff)) {
+				goto image_open_fail;
+			}
+			if (voff < 0) {
+				SetCursor(&arrow);
+				alert_template(0, ALRT_GENERIC, STRI_GA_IMG_UNKNOWN);
+				image_close();
+				return false;
+			}
+			kind = IMAGE_ZIP;
+			err = zip_load(voff);
+		}
+	}
+	if (err) {
+		goto image_open_fail;
+	}
+	if (err = image_list(root)) {
+		goto image_open_fail;
+	}
+	SetCursor(&arrow);
+	return true;
+
+image_open_fail:
+	SetCursor(&arrow);
+	image_alert(err);
+	image_close();
+	return false;
+}
+
+/**
+ * Releases everything used by the open image, if there is one.
+ */
+void image_close(void)
+{
+	if (! iopen) return;
+
+	DisposHandle(cache);
+	DisposHandle(slots);
+	DisposHandle(entries);
+	iso_unload();
+	iopen = false;
+}
+
+/**
+ * Shows an alert for an error from reading the image.
+ *
+ * @param err  the error from image_read() or the filesystem code.
+ */
+void image_alert(long err)
+{
+	if (err == IMAGE_BAD_DATA) {
+		alert_template(0, ALRT_GENERIC, STRI_GA_IMG_BAD);
+	} else {
+		scsi_alert(err);
+	}
+}
+
+/**
+ * @return  the size of the image in bytes.
+ */
+long image_size(void)
+{
+	return fsize;
+}
+
+/**
+ * @return  the offset of the HFS volume within the image, or -1 if the image open
+ *          is not HFS.
+ */
+long image_hfs_offset(void)
+{
+	return (iopen && kind == IMAGE_HFS ? hoff : -1);
+}
+
+/**
+ * Reads bytes from anywhere in the image.
+ *
+ * @param offset  the offset in the image.
+ * @param buf     where to put the data.
+ * @param len     the number of bytes to read.
+ * @return        zero on success, IMAGE_BAD_DATA if the range is not within the
+ *                image, otherwise the SCSI fail code.
+ */
+long image_read(long offset, char *buf, long len)
+{
+	long blk, pos, n, err;
+	short slot;
+
+	if (offset < 0 || len < 0 || offset + len > fsize) {
+		return IMAGE_BAD_DATA;
+	}
+
+	if (len <= IMAGE_BLK_SIZE) {
+		while (len > 0) {
+			if (err = image_slot(offset / IMAGE_BLK_SIZE, &slot)) {
+				return err;
+			}
+			pos = offset % IMAGE_BLK_SIZE;
+			n = IMAGE_BLK_SIZE - pos;
+			if (n > len) n = len;
+			BlockMove(*slots + slot * IMAGE_BLK_SIZE + pos, buf, n);
+			buf += n;
+			offset += n;
+			len -= n;
+		}
+		return 0;
+	}
+
+	while (len > 0) {
+		blk = offset / IMAGE_BLK_SIZE;
+		if (ccnt == 0 || blk < cblk || blk >= cblk + ccnt) {
+			if (err = image_fill(blk, (offset + len - 1) / IMAGE_BLK_SIZE - blk + 1)) {
+				return err;
+			}
+		}
+
+		pos = offset - cblk * IMAGE_BLK_SIZE;
+		n = ccnt * IMAGE_BLK_SIZE - pos;
+		if (n > len) n = len;
+		BlockMove(*cache + pos, buf, n);
+		buf += n;
+		offset += n;
+		len -= n;
+	}
+	return 0;
+}
+
+/**
+ * Replaces the entry table with the contents of a directory.
+ *
+ * @param id  the directory ID.
+ * @return    zero on success, otherwise the error from reading.
+ */
+long image_list(long id)
+{
+	ecount = 0;
+	if (kind == IMAGE_ISO) {
+		return iso_list(id);
+	} else if (kind == IMAGE_ZIP) {
+		return zip_list(id);
+	}
+	return hfs_list(id);
+}
+
+/**
+ * Works out where in the image part of a file is.
+ *
+ * @param e       the file.
+ * @param fork    FORK_DATA or FORK_RSRC.
+ * @param pos     the offset within the fork.
+ * @param offset  set to the offset within the image.
+ * @param run     set to how many bytes are contiguous from there.
+ * @return        zero on success, otherwise the error from the filesystem code.
+ */
+static long image_map(ImageEntry *e, short fork, long pos, long *offset, long *run)
+{
+	if (kind == IMAGE_ISO) {
+		return iso_map(e, fork, pos, offset, run);
+	} else if (kind == IMAGE_ZIP) {
+		return zip_map(e, fork, pos, offset, run);
+	}
+	return hfs_map(e, fork, pos, offset, run);
+}
+
+/**
+ * Adds an entry to the table, used by the filesystem code while listing.
+ *
+ * @param e  the entry, which is copied.
+ * @return   true on success, false if the table is full.
+ */
+Boolean image_add(ImageEntry *e)
+{
+	if (ecount >= IMAGE_MAX_ENTRIES) {
+		return false;
+	}
+	if (ecount >= ealloc) {
+		SetHandleSize(entries, (ealloc + IMAGE_GROW) * sizeof(ImageEntry));
+		if (MemError()) {
+			mem_fail();
+		}
+		ealloc += IMAGE_GROW;
+	}
+	BlockMove(e, *entries + ecount * sizeof(ImageEntry), sizeof(ImageEntry));
+	ecount++;
+	return true;
+}
+
+/**
+ * @return  the number of entries in the table.
+ */
+long image_count(void)
+{
+	return ecount;
+}
+
+/**
+ * Gets a copy of an entry from the table.
+ *
+ * @param i  the entry number.
+ * @param e  set to the entry.
+ * @return   true if the entry exists.
+ */
+Boolean image_get(long i, ImageEntry *e)
+{
+	if (i < 0 || i >= ecount) return false;
+	BlockMove(*entries + i * sizeof(ImageEntry), e, sizeof(ImageEntry));
+	return true;
+}
+
+/**
+ * @return  the directory ID of the top directory of the image.
+ */
+long image_root(void)
+{
+	return root;
+}
+
+/**
+ * Gets the directory currently in the entry table.
+ *
+ * @param name    set to the name of the directory if not null.
+ * @param parent  set to the directory ID of its parent if not null.
+ * @return        the directory ID.
+ */
+long image_dir(unsigned char *name, long *parent)
+{
+	if (name) {
+		BlockMove(dname, name, dname[0] + 1);
+	}
+	if (parent) {
+		*parent = dparent;
+	}
+	return dir;
+}
+
+/**
+ * Sets the top directory of the image, used by the filesystem code while loading.
+ *
+ * @param id  the directory ID of the top directory.
+ */
+void image_set_root(long id)
+{
+	root = id;
+}
+
+/**
+ * Sets the directory being listed, used by the filesystem code while listing.
+ *
+ * @param id      the directory ID.
+ * @param parent  the directory ID of its parent.
+ * @param name    the name of the directory, truncated if need be.
+ */
+void image_set_dir(long id, long parent, unsigned char *name)
+{
+	short len;
+
+	dir = id;
+	dparent = parent;
+	len = name[0];
+	if (len > 31) len = 31;
+	BlockMove(&(name[1]), &(dname[1]), len);
+	dname[0] = len;
+}
+
+/**
+ * Copies a file out of the image to a local file. Only the extents of the file are
+ * read from the device. Errors are reported to the user, and partial files removed.
+ *
+ * @param i     the entry number of the file.
+ * @param name  the name of the local file.
+ * @param vref  the volume or working directory for the local file.
+ * @return      true on success, false otherwise.
+ */
+Boolean image_extract(long i, unsigned char *name, short vref)
+{
+	ImageEntry e;
+	ForkInfo info;
+	Ptr buf;
+	short fork, ferr;
+	long len, pos, off, run, err;
+
+	if (! image_get(i, &e) || e.folder) return false;
+
+	BlockMove(name, info.name, name[0] + 1);
+	info.type = e.type;
+	info.creator = e.creator;
+	info.set_info = true;
+	info.flags = e.flags;
+	info.crdate = e.crdate;
+	info.mddate = e.mddate;
+	info.dlen = e.dlen;
+	info.rlen = e.rlen;
+
+	if (! (buf = NewPtr(IMAGE_COPY_SIZE))) {
+		mem_fail();
+	}
+	busy_cursor();
+
+	/* filesystems without Finder info get a type guessed from the contents */
+	if (! e.type && kind != IMAGE_ZIP) {
+		for (pos = 0; pos < 512; pos++) {
+			buf[pos] = 0;
+		}
+		off = 0;
+		run = 0;
+		if (e.dlen > 0 && (err = image_map(&e, FORK_DATA, 0, &off, &run))) {
+			goto image_extract_fail;
+		}
+		if (run > e.dlen) run = e.dlen;
+		if (run > 512) run = 512;
+		if (err = image_read(off, buf, run)) {
+			goto image_extract_fail;
+		}
+		types_find(buf, e.name, &(info.type), &(info.creator));
+	}
+
+	if (ferr = fork_create(&info, vref, true)) {
+		DisposPtr(buf);
+		SetCursor(&arrow);
+		image_alert_ferr(ferr);
+		return false;
+	}
+
+	err = 0;
+	ferr = 0;
+	if (kind == IMAGE_ZIP) {
+		/* archive members are decoded as they are read, which needs the memory */
+		DisposPtr(buf);
+		err = zip_extract(&e, &info, &ferr);
+	} else {
+		for (fork = FORK_DATA; fork <= FORK_RSRC && ! err && ! ferr; fork++) {
+			len = (fork == FORK_RSRC ? e.rlen : e.dlen);
+			for (pos = 0; pos < len && ! err && ! ferr; pos += run) {
+				if (err = image_map(&e, fork, pos, &off, &run)) break;
+				if (run > len - pos) run = len - pos;
+				if (run > IMAGE_COPY_SIZE) run = IMAGE_COPY_SIZE;
+				if (err = image_read(off, buf, run)) break;
+				ferr = fork_write(fork, buf, run);
+			}
+		}
+		DisposPtr(buf);
+	}
+	SetCursor(&arrow);
+
+	if (err || ferr) {
+		fork_abort();
+		if (err == IMAGE_UNSUPPORTED) {
+			alert_template_text(0, ALRT_GENERIC, STRI_GA_IMG_METHOD, e.name);
+		} else if (err == IMAGE_BAD_CRC) {
+			alert_template_text(ATYPE_CAUTION, ALRT_GENERIC, STRI_GA_CRC_BAD, e.name);
+		} else if (err) {
+			image_alert(err);
+		} else {
+			image_alert_ferr(ferr);
+		}
+		return false;
+	}
+	if (ferr = fork_close()) {
+		image_alert_ferr(ferr);
+		return false;
+	}
+	return true;
+
+image_extract_fail:
+	DisposPtr(buf);
+	SetCursor(&arrow);
+	image_alert(err);
+	return false;
+}
@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2026 saybur
+ *
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this
+ * program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __IMAGEH__
+#define __IMAGEH__
+
+#include "fork.h"
+
+#define IMAGE_BLK_SIZE  4096L
+
+/* returned by image_read() for requests outside the image */
+#define IMAGE_BAD_DATA  1L
+
+/* returned when extracting ZIP members that cannot be decoded, or are damaged */
+#define IMAGE_UNSUPPORTED 2L
+#define IMAGE_BAD_CRC   3L
+
+#define IMAGE_NONE      0
+#define IMAGE_HFS       1
+#define IMAGE_ISO       2
+#define IMAGE_ZIP       3
+
+typedef struct {
+	Str31 name;
+	long parent;               /* directory the entry is in */
+	long id;                   /* directory ID of folders, file number of files */
+	Boolean folder;
+	long type;
+	long creator;
+	short flags;
+	unsigned long crdate;
+	unsigned long mddate;
+	long dlen;
+	long rlen;
+	unsigned short ext[2][6];  /* HFS first extent records, data then resource */
+	long start[2];             /* ISO 9660 first logical blocks, data then resource */
+	long csize;                /* ZIP compressed size, method and CRC-32 */
+	short method;
+	unsigned long crc;
+} ImageEntry;
+
+Boolean image_open(short scsi, short item);
+void image_close(void);
+void image_alert(long err);
+long image_size(void);
+long image_hfs_offset(void);
+long image_read(long offset, char *buf, long len);
+long image_list(long dir);
+Boolean image_add(ImageEntry *e);
+long image_count(void);
+Boolean image_get(long i, ImageEntry *e);
+long image_root(void);
+long image_dir(unsigned char *name, long *parent);
+void image_set_root(long id);
+void image_set_dir(long id, long parent, unsigned char *name);
+Boolean image_extract(long i, unsigned char *name, short vref);
+
+#endif /* __IMAGEH__ */
@@ -0,0 +1,458 @@
+/*
+ * Copyright (C) 2026 saybur
+ *
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this
+ * program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "inflate.h"
+#include "util.h"
+
+/*
+ * This compilation unit decodes deflate data (RFC 1951), as used by ZIP archives.
+ * It is a small, straightforward decoder after Mark Adler's puff.c: Huffman codes
+ * are decoded a bit at a time from canonical code counts rather than with lookup
+ * tables. That is slower, but needs very little memory and the bus is slower still.
+ *
+ * Input is pulled through a callback as it is needed and output is pushed through
+ * another each time the 32K history window fills, so nothing of any size has to be
+ * held in memory.
+ */
+
+#define INF_WINDOW    32768L
+#define INF_IN_SIZE   8192L
+
+#define INF_MAXBITS   15
+#define INF_MAXLCODES 286
+#define INF_MAXDCODES 30
+#define INF_FIXLCODES 288
+
+typedef struct {
+	short *count;
+	short *symbol;
+} Huffman;
+
+static long (*inf_in)(unsigned char *buf, long *len);
+static long (*inf_out)(unsigned char *buf, long len);
+static long ierr;
+
+static unsigned char *ibuf;
+static long ipos, ilen;
+static unsigned long bitbuf;
+static short bitcnt;
+
+static unsigned char *win;
+static long wpos, total;
+
+static short lencnt[INF_MAXBITS + 1], lensym[INF_FIXLCODES];
+static short distcnt[INF_MAXBITS + 1], distsym[INF_MAXDCODES];
+
+/* base values and extra bits for length codes 257-285 and distance codes 0-29 */
+static const short lbase[29] = {
+		3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+		35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const short lext[29] = {
+		0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+		3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+static const unsigned short dbase[30] = {
+		1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+		257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+		8193, 12289, 16385, 24577 };
+static const short dext[30] = {
+		0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+		7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+/* order of the code length code lengths in a dynamic block header */
+static const short order[19] = {
+		16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+/**
+ * Gets the next byte of input, refilling the buffer from the callback as needed.
+ * On failure ierr is set and zero returned.
+ */
+static short inf_byte(void)
+{
+	long err;
+
+	if (ipos >= ilen) {
+		if (ierr) return 0;
+		ilen = INF_IN_SIZE;
+		if (err = inf_in(ibuf, &ilen)) {
+			ierr = err;
+			return 0;
+		}
+		if (ilen <= 0) {
+			/* ran out of input before the end of the data */
+			ierr = INFLATE_BAD_DATA;
+			ilen = 0;
+			return 0;
+		}
+		ipos = 0;
+	}
+	return ibuf[ipos++];
+}
+
+/**
+ * Gets some number of bits from the input, least significant first.
+ */
+static long inf_bits(short need)
+{
+	unsigned long val;
+
+	val = bitbuf;
+	while (bitcnt < need) {
+		val |= (unsigned long) inf_byte() << bitcnt;
+		if (ierr) return 0;
+		bitcnt += 8;
+	}
+	bitbuf = val >> need;
+	bitcnt -= need;
+	return (long) (val & ((1UL << need) - 1));
+}
+
+/**
+ * Puts a byte in the window, passing the window on to the output callback each
+ * time it fills.
+ */
+static void inf_put(unsigned char c)
+{
+	long err;
+
+	win[wpos++] = c;
+	total++;
+	if (wpos == INF_WINDOW) {
+		wpos = 0;
+		if (err = inf_out(win, INF_WINDOW)) {
+			ierr = err;
+		}
+	}
+}
+
+/**
+ * Copies a stored block, which is not compressed.
+ */
+static void inf_stored(void)
+{
+	long len, nlen;
+
+	/* stored data starts on a byte boundary */
+	bitbuf = 0;
+	bitcnt = 0;
+
+	len = inf_byte();
+	len |= (long) inf_byte() << 8;
+	nlen = inf_byte();
+	nlen |= (long) inf_byte() << 8;
+	if (ierr) return;
+	if (len != (~nlen & 0xFFFFL)) {
+		ierr = INFLATE_BAD_DATA;
+		return;
+	}
+
+	while (len-- > 0 && ! ierr) {
+		inf_put((unsigned char) inf_byte());
+	}
+}
+
+/**
+ * Decodes one symbol with a Huffman code.
+ *
+ * @return  the symbol, or -1 if the code is not valid.
+ */
+static short inf_decode(Huffman *h)
+{
+	short len, code, first, count, index;
+
+	code = first = index = 0;
+	for (len = 1; len <= INF_MAXBITS; len++) {
+		code |= (short) inf_bits(1);
+		if (ierr) return -1;
+		count = h->count[len];
+		if (code - count < first) {
+			return h->symbol[index + (code - first)];
+		}
+		index += count;
+		first += count;
+		first <<= 1;
+		code <<= 1;
+	}
+	return -1;
+}
+
+/**
+ * Builds a Huffman code from a list of code lengths.
+ *
+ * @return  zero for a complete code, negative if over-subscribed, positive if
+ *          incomplete.
+ */
+static short inf_construct(Huffman *h, short *length, short n)
+{
+	short symbol, len, left;
+	short offs[INF_MAXBITS + 1];
+
+	for (len = 0; len <= INF_MAXBITS; len++) {
+		h->count[len] = 0;
+	}
+	for (symbol = 0; symbol < n; symbol++) {
+		h->count[length[symbol]]++;
+	}
+	if (h->count[0] == n) {
+		return 0;
+	}
+
+	left = 1;
+	for (len = 1; len <= INF_MAXBITS; len++) {
+		left <<= 1;
+		left -= h->count[len];
+		if (left < 0) return left;
+	}
+
+	offs[1] = 0;
+	for (len = 1; len < INF_MAXBITS; len++) {
+		offs[len + 1] = offs[len] + h->count[len];
+	}
+	for (symbol = 0; symbol < n; symbol++) {
+		if (length[symbol] != 0) {
+			h->symbol[offs[length[symbol]]++] = symbol;
+		}
+	}
+	return left;
+}
+
+/**
+ * Decodes literals and length/distance pairs until the end of block code.
+ */
+static void inf_codes(Huffman *lencode, Huffman *distcode)
+{
+	short symbol;
+	long len, dist, from;
+
+	for (;;) {
+		symbol = inf_decode(lencode);
+		if (ierr) return;
+		if (symbol < 0) {
+			ierr = INFLATE_BAD_DATA;
+			return;
+		}
+
+		if (symbol < 256) {
+			inf_put((unsigned char) symbol);
+			if (ierr) return;
+		} else if (symbol == 256) {
+			return;
+		} else {
+			symbol -= 257;
+			if (symbol >= 29) {
+				ierr = INFLATE_BAD_DATA;
+				return;
+			}
+			len = lbase[symbol] + inf_bits(lext[symbol]);
+
+			symbol = inf_decode(distcode);
+			if (ierr) return;
+			if (symbol < 0 || symbol >= 30) {
+				ierr = INFLATE_BAD_DATA;
+				return;
+			}
+			dist = (long) dbase[symbol] + inf_bits(dext[symbol]);
+			if (ierr) return;
+			if (dist > total) {
+				/* refers back to before the start */
+				ierr = INFLATE_BAD_DATA;
+				return;
+			}
+
+			from = wpos - dist;
+			if (from < 0) from += INF_WINDOW;
+			while (len-- > 0 && ! ierr) {
+				inf_put(win[from]);
+				if (++from == INF_WINDOW) from = 0;
+			}
+			if (ierr) return;
+		}
+	}
+}
+
+/**
+ * Decodes a block with the fixed Huffman codes.
+ */
+static void inf_fixed(void)
+{
+	Huffman lencode, distcode;
+	short lengths[INF_FIXLCODES];
+	short symbol;
+
+	lencode.count = lencnt;
+	lencode.symbol = lensym;
+	distcode.count = distcnt;
+	distcode.symbol = distsym;
+
+	for (symbol = 0; symbol < 144; symbol++) lengths[symbol] = 8;
+	for (; symbol < 256; symbol++) lengths[symbol] = 9;
+	for (; symbol < 280; symbol++) lengths[symbol] = 7;
+	for (; symbol < INF_FIXLCODES; symbol++) lengths[symbol] = 8;
+	inf_construct(&lencode, lengths, INF_FIXLCODES);
+
+	for (symbol = 0; symbol < INF_MAXDCODES; symbol++) lengths[symbol] = 5;
+	inf_construct(&distcode, lengths, INF_MAXDCODES);
+
+	inf_codes(&lencode, &distcode);
+}
+
+/**
+ * Decodes a block with Huffman codes given at the start of the block.
+ */
+static void inf_dynamic(void)
+{
+	Huffman lencode, distcode;
+	short lengths[INF_MAXLCODES + INF_MAXDCODES];
+	short nlen, ndist, ncode, index, symbol, len, err;
+
+	lencode.count = lencnt;
+	lencode.symbol = lensym;
+	distcode.count = distcnt;
+	distcode.symbol = distsym;
+
+	nlen = (short) inf_bits(5) + 257;
+	ndist = (short) inf_bits(5) + 1;
+	ncode = (short) inf_bits(4) + 4;
+	if (ierr) return;
+	if (nlen > INF_MAXLCODES || ndist > INF_MAXDCODES) {
+		ierr = INFLATE_BAD_DATA;
+		return;
+	}
+
+	/* code lengths for the code length alphabet */
+	for (index = 0; index < ncode; index++) {
+		lengths[order[index]] = (short) inf_bits(3);
+	}
+	for (; index < 19; index++) {
+		lengths[order[index]] = 0;
+	}
+	if (ierr) return;
+	if (inf_construct(&lencode, lengths, 19) != 0) {
+		ierr = INFLATE_BAD_DATA;
+		return;
+	}
+
+	/* literal/length and distance code lengths */
+	index = 0;
+	while (index < nlen + ndist) {
+		symbol = inf_decode(&lencode);
+		if (ierr) return;
+		if (symbol < 0) {
+			ierr = INFLATE_BAD_DATA;
+			return;
+		}
+		if (symbol < 16) {
+			lengths[index++] = symbol;
+		} else {
+			len = 0;
+			if (symbol == 16) {
+				if (index == 0) {
+					ierr = INFLATE_BAD_DATA;
+					return;
+				}
+				len = lengths[index - 1];
+				symbol = 3 + (short) inf_bits(2);
+			} else if (symbol == 17) {
+				symbol = 3 + (short) inf_bits(3);
+			} else {
+				symbol = 11 + (short) inf_bits(7);
+			}
+			if (ierr) return;
+			if (index + symbol > nlen + ndist) {
+				ierr = INFLATE_BAD_DATA;
+				return;
+			}
+			while (symbol--) {
+				lengths[index++] = len;
+			}
+		}
+	}
+
+	/* there must be an end of block code */
+	if (lengths[256] == 0) {
+		ierr = INFLATE_BAD_DATA;
+		return;
+	}
+
+	/* incomplete codes are only allowed for a single length 1 code */
+	err = inf_construct(&lencode, lengths, nlen);
+	if (err < 0 || (err > 0 && nlen - lencode.count[0] != 1)) {
+		ierr = INFLATE_BAD_DATA;
+		return;
+	}
+	err = inf_construct(&distcode, lengths + nlen, ndist);
+	if (err < 0 || (err > 0 && ndist - distcode.count[0] != 1)) {
+		ierr = INFLATE_BAD_DATA;
+		return;
+	}
+
+	inf_codes(&lencode, &distcode);
+}
+
+/**
+ * Decodes a deflate stream.
+ *
+ * @param in   called for more input: fills the buffer with up to *len bytes and sets
+ *             *len to the number given, returning non-zero on error.
+ * @param out  called with each part of the output, returning non-zero on error.
+ * @return     zero on success, INFLATE_BAD_DATA if the data is not valid, otherwise
+ *             the error from a callback.
+ */
+long inflate_run(long (*in)(unsigned char *buf, long *len),
+		long (*out)(unsigned char *buf, long len))
+{
+	short last, type;
+
+	if (! (ibuf = (unsigned char *) NewPtr(INF_IN_SIZE))) {
+		mem_fail();
+	}
+	if (! (win = (unsigned char *) NewPtr(INF_WINDOW))) {
+		mem_fail();
+	}
+	inf_in = in;
+	inf_out = out;
+	ierr = 0;
+	ipos = 0;
+	ilen = 0;
+	bitbuf = 0;
+	bitcnt = 0;
+	wpos = 0;
+	total = 0;
+
+	do {
+		last = (short) inf_bits(1);
+		type = (short) inf_bits(2);
+		if (ierr) break;
+
+		if (type == 0) {
+			inf_stored();
+		} else if (type == 1) {
+			inf_fixed();
+		} else if (type == 2) {
+			inf_dynamic();
+		} else {
+			ierr = INFLATE_BAD_DATA;
+		}
+	} while (! last && ! ierr);
+
+	/* whatever is left in the window */
+	if (! ierr && wpos > 0) {
+		ierr = out(win, wpos);
+	}
+
+	DisposPtr((Ptr) win);
+	DisposPtr((Ptr) ibuf);
+	return ierr;
+}
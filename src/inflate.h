@@ -0,0 +1,26 @@
+/*
+ * Copyright (C) 2026 saybur
+ *
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this
+ * program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __INFLATEH__
+#define __INFLATEH__
+
+/* returned by inflate_run() when the compressed data is not valid */
+#define INFLATE_BAD_DATA  1L
+
+long inflate_run(long (*in)(unsigned char *buf, long *len),
+		long (*out)(unsigned char *buf, long len));
+
+#endif /* __INFLATEH__ */
@@ -0,0 +1,361 @@
+/*
+ * Copyright (C) 2026 saybur
+ *
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this
+ * program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "iso.h"
+#include "util.h"
+
+/*
+ * This compilation unit reads the directories of an ISO 9660 CD image on the device.
+ * The primary volume descriptor gives the root directory and the path table, which
+ * is kept to name directories when going back up the tree. Directories are read a
+ * sector at a time as they are opened. Files are single extents, so reading one is
+ * just a matter of offsetting from its first block.
+ *
+ * The Apple extensions are understood: an "AA" system use entry carries the type,
+ * creator and Finder flags, and a resource fork is stored as an associated file with
+ * the same name just before the data fork. Joliet and Rock Ridge names are not read,
+ * the plain ISO 9660 names are used. Hybrid discs are opened on their HFS side by
+ * image_open(), which tries HFS first.
+ *
+ * See ECMA-119 for the structures used here.
+ */
+
+#define ISO_SECTOR        2048L
+#define ISO_PVD_SECTOR    16
+#define ISO_MAX_VDS       16
+#define ISO_VD_PRIMARY    1
+#define ISO_VD_END        255
+
+/* directory record flags */
+#define ISO_FLAG_DIR      0x02
+#define ISO_FLAG_ASSOC    0x04
+
+/* the path table is only kept if it is no bigger than this */
+#define ISO_MAX_PATHS     32768L
+
+/* Apple extension system use entry */
+#define ISO_SU_APPLE      0x4141  /* 'AA' */
+#define ISO_SU_APPLE_LEN  14
+
+static long bsize, root, rsize;
+static Str31 vname;
+static Handle paths;
+static long plen;
+
+/**
+ * Copies a name, dropping the ";1" version and the trailing dot of names without
+ * an extension, and truncating to fit.
+ *
+ * @param src  the name.
+ * @param len  the length of the name.
+ * @param dst  set to the Pascal name.
+ */
+static void iso_name(unsigned char *src, short len, unsigned char *dst)
+{
+	short i;
+
+	for (i = 0; i < len; i++) {
+		if (src[i] == ';') break;
+	}
+	len = i;
+	if (len > 0 && src[len - 1] == '.') len--;
+	if (len > 31) len = 31;
+	BlockMove(src, &(dst[1]), len);
+	dst[0] = len;
+}
+
+/**
+ * Converts a directory record date to Mac time.
+ *
+ * @param p  the seven byte date.
+ * @return   seconds since 1904, or zero if the date is not set.
+ */
+static unsigned long iso_date(unsigned char *p)
+{
+	DateTimeRec dt;
+	unsigned long secs;
+
+	if (p[0] == 0) return 0;
+	dt.year = 1900 + p[0];
+	dt.month = p[1];
+	dt.day = p[2];
+	dt.hour = p[3];
+	dt.minute = p[4];
+	dt.second = p[5];
+	dt.dayOfWeek = 0;
+	Date2Secs(&dt, &secs);
+	return secs;
+}
+
+/**
+ * Looks for the Apple extension in the system use area of a directory record,
+ * updating the entry with the Finder information if it is there.
+ *
+ * @param su   the start of the system use area.
+ * @param len  its length.
+ * @param e    the entry.
+ */
+static void iso_apple(unsigned char *su, short len, ImageEntry *e)
+{
+	short p;
+
+	for (p = 0; p + 4 <= len && su[p + 2] >= 4; p += su[p + 2]) {
+		if (be16(su + p) == ISO_SU_APPLE && su[p + 2] >= ISO_SU_APPLE_LEN
+				&& p + ISO_SU_APPLE_LEN <= len) {
+			e->type = be32(su + p + 4);
+			e->creator = be32(su + p + 8);
+			e->flags = be16(su + p + 12);
+			return;
+		}
+	}
+}
+
+/**
+ * Finds the name of a directory in the path table.
+ *
+ * @param dir   the first block of the directory.
+ * @param name  set to the name, or left empty if the directory is not found.
+ */
+static void iso_dir_name(long dir, unsigned char *name)
+{
+	unsigned char *p;
+	long pos;
+	short len;
+
+	name[0] = 0;
+	if (dir == root) {
+		BlockMove(vname, name, vname[0] + 1);
+		return;
+	}
+	if (! paths) return;
+
+	HLock(paths);
+	for (pos = 0; pos + 8 < plen; pos += 8 + len + (len & 1)) {
+		p = (unsigned char *) *paths + pos;
+		len = p[0];
+		if (len == 0) break;
+		if (le32(p + 2) == dir && pos + 8 + len <= plen) {
+			iso_name(p + 8, len, name);
+			break;
+		}
+	}
+	HUnlock(paths);
+}
+
+/**
+ * Checks if the image is an ISO 9660 CD image by looking for the primary volume
+ * descriptor among the volume descriptors.
+ *
+ * @param voff  set to the offset of the primary volume descriptor, or -1 if there is
+ *              not one.
+ * @return      zero on success, otherwise the error from reading.
+ */
+long iso_probe(long *voff)
+{
+	unsigned char vd[8];
+	long err, off;
+	short i;
+
+	*voff = -1;
+	for (i = 0; i < ISO_MAX_VDS; i++) {
+		off = (ISO_PVD_SECTOR + i) * ISO_SECTOR;
+		if (err = image_read(off, (char *) vd, sizeof(vd))) {
+			return (err == IMAGE_BAD_DATA ? 0 : err);
+		}
+		if (! str_eq((char *) vd + 1, "CD001", 5)) break;
+		if (vd[0] == ISO_VD_PRIMARY) {
+			*voff = off;
+			break;
+		}
+		if (vd[0] == ISO_VD_END) break;
+	}
+	return 0;
+}
+
+/**
+ * Reads the primary volume descriptor and the path table.
+ *
+ * @param voff  the offset of the primary volume descriptor, from iso_probe().
+ * @return      zero on success, otherwise the error from reading.
+ */
+long iso_load(long voff)
+{
+	unsigned char pvd[190];
+	long err;
+	short len;
+
+	if (err = image_read(voff, (char *) pvd, sizeof(pvd))) {
+		return err;
+	}
+	bsize = be16(pvd + 130);
+	if (bsize < 512 || bsize > ISO_SECTOR) {
+		return IMAGE_BAD_DATA;
+	}
+	root = be32(pvd + 156 + 6);
+	rsize = be32(pvd + 156 + 14);
+
+	/* volume identifier is padded with spaces */
+	for (len = 32; len > 0 && pvd[40 + len - 1] == ' '; len--) ;
+	iso_name(pvd + 40, len, vname);
+
+	iso_unload();
+	plen = be32(pvd + 136);
+	if (plen > 0 && plen <= ISO_MAX_PATHS) {
+		if (! (paths = NewHandle(plen))) {
+			mem_fail();
+		}
+		HLock(paths);
+		err = image_read(le32(pvd + 140) * bsize, *paths, plen);
+		HUnlock(paths);
+		if (err) {
+			DisposHandle(paths);
+			paths = 0L;
+			if (err != IMAGE_BAD_DATA) return err;
+		}
+	}
+
+	image_set_root(root);
+	return 0;
+}
+
+/**
+ * Releases the path table read by iso_load(), if there is one.
+ */
+void iso_unload(void)
+{
+	if (paths) {
+		DisposHandle(paths);
+		paths = 0L;
+	}
+}
+
+/**
+ * Lists a directory into the image entry table. The "." record gives the size of
+ * the directory and ".." gives its parent. Directory reads are small, and so are
+ * served from the image_read() block cache when a directory is opened again.
+ *
+ * @param dir  the first block of the directory.
+ * @return     zero on success, otherwise the error from reading.
+ */
+long iso_list(long dir)
+{
+	unsigned char *sec, *r;
+	ImageEntry e, assoc;
+	Str31 name;
+	long size, pos, parent, err;
+	short p, len, nlen, su;
+	Boolean have_assoc;
+
+	if (! (sec = (unsigned char *) NewPtr(ISO_SECTOR))) {
+		mem_fail();
+	}
+
+	size = (dir == root ? rsize : ISO_SECTOR);
+	parent = 0;
+	have_assoc = false;
+	err = 0;
+	for (pos = 0; pos < size && ! err; pos += ISO_SECTOR) {
+		if (err = image_read(dir * bsize + pos, (char *) sec, ISO_SECTOR)) break;
+
+		/* records do not cross sectors */
+		for (p = 0; p + 34 <= ISO_SECTOR; p += len) {
+			r = sec + p;
+			len = r[0];
+			if (len == 0) break; /* rest of the sector is unused */
+			if (len < 34 || p + len > ISO_SECTOR) {
+				err = IMAGE_BAD_DATA;
+				break;
+			}
+			nlen = r[32];
+			if (33 + nlen > len) {
+				err = IMAGE_BAD_DATA;
+				break;
+			}
+
+			/* "." and ".." */
+			if (nlen == 1 && r[33] <= 1) {
+				if (r[33] == 0) {
+					size = be32(r + 14);
+				} else {
+					parent = be32(r + 6);
+				}
+				continue;
+			}
+
+			iso_name(r + 33, nlen, e.name);
+			e.parent = dir;
+			e.folder = (r[25] & ISO_FLAG_DIR) != 0;
+			e.id = (e.folder ? be32(r + 6) : 0);
+			e.type = 0;
+			e.creator = 0;
+			e.flags = 0;
+			e.crdate = iso_date(r + 18);
+			e.mddate = e.crdate;
+			e.dlen = (e.folder ? 0 : be32(r + 14));
+			e.rlen = 0;
+			e.start[FORK_DATA] = be32(r + 6);
+			e.start[FORK_RSRC] = 0;
+			su = 33 + nlen + ((nlen & 1) ? 0 : 1);
+			iso_apple(r + su, len - su, &e);
+
+			/* resource forks are associated files just before the data fork */
+			if (r[25] & ISO_FLAG_ASSOC) {
+				BlockMove(&e, &assoc, sizeof(ImageEntry));
+				have_assoc = true;
+				continue;
+			}
+			if (have_assoc && EqualString(assoc.name, e.name, true, true)) {
+				e.start[FORK_RSRC] = assoc.start[FORK_DATA];
+				e.rlen = assoc.dlen;
+			}
+			have_assoc = false;
+
+			if (! image_add(&e)) {
+				/* table is full, show what fit */
+				pos = size;
+				break;
+			}
+		}
+	}
+	DisposPtr((Ptr) sec);
+
+	iso_dir_name(dir, name);
+	image_set_dir(dir, parent, name);
+	return err;
+}
+
+/**
+ * Works out where in the image part of a file is.
+ *
+ * @param e       the file.
+ * @param fork    FORK_DATA or FORK_RSRC.
+ * @param pos     the offset within the fork.
+ * @param offset  set to the offset within the image.
+ * @param run     set to how many bytes are contiguous from there.
+ * @return        zero on success, otherwise IMAGE_BAD_DATA.
+ */
+long iso_map(ImageEntry *e, short fork, long pos, long *offset, long *run)
+{
+	long len;
+
+	len = (fork == FORK_RSRC ? e->rlen : e->dlen);
+	if (pos < 0 || pos >= len) {
+		return IMAGE_BAD_DATA;
+	}
+	*offset = e->start[fork] * bsize + pos;
+	*run = len - pos;
+	return 0;
+}
@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) 2026 saybur
+ *
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this
+ * program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "crc.h"
+#include "macbin.h"
+#include "util.h"
+
+/*
+ * This compilation unit handles the MacBinary format, which packs both forks and the
+ * Finder information of a file into one flat file. The layout is a 128 byte header,
+ * an optional secondary header, then the data and resource forks, each padded out to
+ * a multiple of 128 bytes. MacBinary I, II, and III share the same layout; II added a
+ * CRC over the header and the low byte of the Finder flags, and III only added a
+ * signature and some extended Finder fields that are not used here.
+ */
+
+/**
+ * Writes a big-endian 32-bit value into the header.
+ */
+static void macbin_put_long(unsigned char *p, long v)
+{
+	p[0] = (v >> 24) & 0xFF;
+	p[1] = (v >> 16) & 0xFF;
+	p[2] = (v >> 8) & 0xFF;
+	p[3] = v & 0xFF;
+}
+
+/**
+ * Rounds a length up to the 128 byte MacBinary padding.
+ */
+static long macbin_pad(long len)
+{
+	return (len + 127) & ~127L;
+}
+
+/**
+ * Checks if the start of a file is a MacBinary header and, if so, extracts what is
+ * needed to rebuild the original file.
+ *
+ * MacBinary has no real magic number, so this is fairly strict: the fixed zero bytes
+ * must be zero, the name must be legal, the header CRC must match (or for MacBinary I
+ * the later fields must be unused), and the forks must fit in the file.
+ *
+ * @param hdr     the first 128 bytes of the file.
+ * @param size    the size of the whole file.
+ * @param info    set to the name, type, creator, flags, dates, and fork lengths.
+ * @param dstart  set to the offset of the data fork within the file.
+ * @param rstart  set to the offset of the resource fork within the file.
+ * @return        true if this is a usable MacBinary file, false otherwise.
+ */
+Boolean macbin_parse(unsigned char *hdr, long size, ForkInfo *info, long *dstart,
+		long *rstart)
+{
+	short i, shlen, len;
+	unsigned short crc;
+	Boolean mb2;
+
+	if (size < MACBIN_HEAD_SIZE) return false;
+	if (hdr[0] != 0 || hdr[74] != 0 || hdr[82] != 0) return false;
+	if (hdr[1] < 1 || hdr[1] > 63) return false;
+
+	crc = crc16_update(0, hdr, 124);
+	mb2 = (crc == be16(&(hdr[124])));
+	if (! mb2) {
+		for (i = 101; i < 126; i++) {
+			if (hdr[i] != 0) return false;
+		}
+	}
+
+	info->dlen = be32(&(hdr[83]));
+	info->rlen = be32(&(hdr[87]));
+	if (info->dlen < 0 || info->rlen < 0) return false;
+
+	shlen = (mb2 ? be16(&(hdr[120])) : 0);
+	*dstart = MACBIN_HEAD_SIZE + macbin_pad(shlen);
+	*rstart = *dstart + macbin_pad(info->dlen);
+	if (*rstart + info->rlen > size) return false;
+
+	/* HFS names are at most 31 characters */
+	len = (hdr[1] > 31 ? 31 : hdr[1]);
+	BlockMove(&(hdr[2]), &(info->name[1]), len);
+	info->name[0] = len;
+	repl_chars(info->name, ':', '-');
+	info->type = be32(&(hdr[65]));
+	info->creator = be32(&(hdr[69]));
+	info->flags = (hdr[73] << 8) | (mb2 ? hdr[101] : 0);
+	info->crdate = be32(&(hdr[91]));
+	info->mddate = be32(&(hdr[95]));
+	info->set_info = true;
+
+	return true;
+}
+
+/**
+ * Builds a MacBinary III header for a file. This is also a valid MacBinary II header,
+ * so older decoders will accept it as well. There is no secondary header, so the
+ * data fork follows at offset 128 and the resource fork at the next multiple of 128
+ * after that.
+ *
+ * @param hdr   storage for the 128 byte header.
+ * @param info  the name, type, creator, flags, dates, and fork lengths of the file.
+ */
+void macbin_header(unsigned char *hdr, ForkInfo *info)
+{
+	short i;
+	unsigned short crc;
+
+	for (i = 0; i < MACBIN_HEAD_SIZE; i++) {
+		hdr[i] = 0;
+	}
+
+	i = (info->name[0] > 63 ? 63 : info->name[0]);
+	hdr[1] = i;
+	BlockMove(&(info->name[1]), &(hdr[2]), i);
+	macbin_put_long(&(hdr[65]), info->type);
+	macbin_put_long(&(hdr[69]), info->creator);
+	hdr[73] = (info->flags >> 8) & 0xFF;
+	macbin_put_long(&(hdr[83]), info->dlen);
+	macbin_put_long(&(hdr[87]), info->rlen);
+	macbin_put_long(&(hdr[91]), info->crdate);
+	macbin_put_long(&(hdr[95]), info->mddate);
+	hdr[101] = info->flags & 0xFF;
+	macbin_put_long(&(hdr[102]), 'mBIN');
+	hdr[122] = 130; /* written by MacBinary III */
+	hdr[123] = 129; /* readable by MacBinary II */
+
+	crc = crc16_update(0, hdr, 124);
+	hdr[124] = (crc >> 8) & 0xFF;
+	hdr[125] = crc & 0xFF;
+}
+
+/**
+ * @param info  the fork lengths of a file.
+ * @return      the size of the MacBinary encoding of that file.
+ */
+long macbin_size(ForkInfo *info)
+{
+	return MACBIN_HEAD_SIZE + macbin_pad(info->dlen) + macbin_pad(info->rlen);
+}
@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2024 saybur
+ * Copyright (C) 2024-2026 saybur
  *
  * This program is free software: you can redistribute it and/or modify it under the
  * terms of the GNU General Public License as published by the Free Software
@@ -14,16 +14,20 @@
  * program. If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include "browse.h"
 #include "config.h"
 #include "constants.h"
 #include "dialog.h"
 #include "emu.h"
+#include "prefetch.h"
+#include "preview.h"
 #include "progress.h"
 #include "scsi.h"
 #include "window.h"
 #include "transfer.h"
 #include "upload.h"
 #include "util.h"
+#include "vdisk.h"
 
 #define STATE_IDLE      1
 #define STATE_OPEN      2
@@ -33,10 +37,17 @@
 #define MENU_STATE_DA   0x0100;
 #define MENU_STATE_OPN  0x0200;
 
+/* how often, in ticks, to ask the device if its listing changed; see do_watch() */
+#define WATCH_TICKS     600
+#define WATCH_MAX_BACK  3
+
 static short scsi_id;
 static unsigned char tb_api;
 static short open_type;
 static short pstate, menu_state;
+static Boolean peeking;
+static long watch_last;
+static short watch_back;
 
 static void init_menus(void)
 {
@@ -53,6 +64,14 @@ static void init_menus(void)
 	InsertMenu(h, 0);
 	DisableItem(h, 0); /* gray out to start with */
 
+	h = GetMenu(MENU_OPTIONS);
+	InsertMenu(h, 0);
+	CheckItem(h, MENUI_VERIFY, g_verify_upload);
+	CheckItem(h, MENUI_MACBIN, g_decode_macbin);
+	CheckItem(h, MENUI_BINHEX, g_decode_binhex);
+	CheckItem(h, MENUI_UP_MACBIN, g_upload_macbin);
+	CheckItem(h, MENUI_WATCH, g_watch_device);
+
 	DrawMenuBar();
 }
 
@@ -60,29 +79,32 @@ static void init_menus(void)
  * Performs a file/image list update from the emulator using stored values.
  * This will automatically show or hide the window based on the results of the
  * operation, updating the program state accordingly.
+ *
+ * @param fresh  true to always fetch the listing, as when it is known to have
+ *               changed; false to use the cached one if the item count still
+ *               matches, see emu_list_cached().
  */
-static void do_list_update(void)
+static void do_list_update(Boolean fresh)
 {
-	Handle h;
 	long err;
-	short length, count;
+	short count;
 	Str15 ns;
 
 	busy_cursor();
-	if (err = scsi_list_files(scsi_id, open_type, &h, &length)) {
+	if (fresh) {
+		err = emu_list(scsi_id, open_type, &count);
+	} else {
+		err = emu_list_cached(scsi_id, open_type, &count);
+	}
+	if (scsi_is_attention(err) && config_recheck(scsi_id)) {
+		/* device was reset or had the card changed; now cleared, try again */
+		err = emu_list(scsi_id, open_type, &count);
+	}
+	if (err) {
 		window_show(false);
 		pstate = STATE_IDLE;
 		scsi_alert(err);
 	} else {
-		if (length <= 0) {
-			count = 0;
-			/* handle never allocated, do not discard */
-			window_populate(scsi_id, open_type, 0, 0);
-		} else {
-			count = window_populate(scsi_id, open_type, h, length);
-			DisposHandle(h);
-		}
-
 		SetCursor(&arrow);
 		if (open_type) {
 			/* images */
@@ -130,12 +152,58 @@ static void do_xfer_stop()
 		upload_end();
 		progress_show(false);
 		window_text(0);
-		do_list_update();
+		/* verifying will have fetched the listing already */
+		do_list_update(! upload_listed());
+	}
+
+	/* give the device a full interval after a transfer before watching again */
+	watch_last = TickCount();
+}
+
+/**
+ * Handles UNIT ATTENTION reported to something running in the background. Reading
+ * the sense data clears the condition, so this may be the only chance to find out
+ * that the device was reset or had its card changed; it is checked again and the
+ * listing reloaded, as if the user had opened it.
+ */
+static void do_attention(void)
+{
+	if (config_recheck(scsi_id)) {
+		do_list_update(true);
+	}
+}
+
+/**
+ * Asks the device whether its listing has changed, bringing the window up to date
+ * if it has; see emu_watch(). This runs now and then while the device is open and
+ * nothing is being transferred, when the watch option is on.
+ *
+ * Errors are not reported, as the user did not ask for anything. Instead the time
+ * until the next check is doubled each time, up to a limit, so a device that has
+ * gone away does not hold up the program with timeouts. A device that was reset or
+ * had its card changed is opened again as if the user had asked.
+ */
+static void do_watch(void)
+{
+	long err;
+	Boolean changed;
+
+	err = emu_watch(scsi_id, open_type, &changed);
+	watch_last = TickCount();
+	if (! err) {
+		watch_back = 0;
+	} else if (scsi_is_attention(err)) {
+		watch_back = 0;
+		do_attention();
+	} else if (watch_back < WATCH_MAX_BACK) {
+		watch_back++;
 	}
 }
 
 static void evt_null(void)
 {
+	long err;
+
 	if (pstate == STATE_DOWNLOAD) {
 		if (! transfer_tick()) {
 			do_xfer_stop();
@@ -146,6 +214,19 @@ static void evt_null(void)
 		}
 	} else {
 		SetCursor(&arrow);
+		vdisk_idle();
+		if (g_watch_device && pstate == STATE_OPEN
+				&& TickCount() - watch_last >= ((long) WATCH_TICKS << watch_back)) {
+			do_watch();
+		}
+		/* read ahead the selected file, then look at the files in view */
+		err = 0;
+		peeking = (pstate == STATE_OPEN && ! open_type
+				&& (prefetch_idle(scsi_id, &err) || window_idle(scsi_id, &err)));
+		if (err) {
+			peeking = false;
+			do_attention();
+		}
 	}
 }
 
@@ -178,6 +259,11 @@ static void update_menus(void)
 		/* set default File state */
 		EnableItem(file, MENUI_OPEN);
 		DisableItem(file, MENUI_UPLOAD);
+		DisableItem(file, MENUI_UPLOAD_VOL);
+		DisableItem(file, MENUI_RANGE);
+		DisableItem(file, MENUI_PREVIEW);
+		DisableItem(file, MENUI_BROWSE);
+		DisableItem(file, MENUI_MOUNT);
 		EnableItem(file, MENUI_QUIT);
 
 		/* disallow Edit, we don't use it */
@@ -191,6 +277,11 @@ static void update_menus(void)
 		/* allow uploading only when we are connected & have files */
 		if (pstate == STATE_OPEN && !open_type) {
 			EnableItem(file, MENUI_UPLOAD);
+			EnableItem(file, MENUI_UPLOAD_VOL);
+			EnableItem(file, MENUI_RANGE);
+			EnableItem(file, MENUI_PREVIEW);
+			EnableItem(file, MENUI_BROWSE);
+			EnableItem(file, MENUI_MOUNT);
 		}
 
 		if (kind < userKind) {
@@ -216,7 +307,7 @@ static void do_open(void)
 			&& config_check_mode(s)) {
 		scsi_id = s;
 		open_type = o;
-		do_list_update();
+		do_list_update(false);
 	}
 }
 
@@ -229,10 +320,75 @@ static void do_upload(void)
 	}
 }
 
-static void do_download(void)
+static void do_upload_volume(void)
+{
+	if (pstate == STATE_OPEN && !open_type && upload_volume_start(scsi_id)) {
+		pstate = STATE_UPLOAD;
+		progress_set_direction(false);
+		progress_show(true);
+	}
+}
+
+static void do_preview(void)
+{
+	short i;
+
+	if (pstate != STATE_OPEN || open_type) return;
+
+	i = 0;
+	window_next(&i);
+	if (i < 0) {
+		SysBeep(1);
+		return;
+	}
+	preview_file(scsi_id, i);
+}
+
+static void do_browse(void)
+{
+	short i;
+
+	if (pstate != STATE_OPEN || open_type) return;
+
+	i = 0;
+	window_next(&i);
+	if (i < 0) {
+		SysBeep(1);
+		return;
+	}
+	browse_image(scsi_id, i);
+}
+
+static void do_mount(void)
+{
+	short i;
+
+	if (pstate != STATE_OPEN || open_type) return;
+
+	i = 0;
+	window_next(&i);
+	if (i < 0) {
+		SysBeep(1);
+		return;
+	}
+	vdisk_mount(scsi_id, i);
+}
+
+static void do_download_show(void)
 {
 	Str15 str;
 
+	pstate = STATE_DOWNLOAD;
+	str_load(STR_GENERAL, STRI_GEN_DOWNLOAD, str, 16);
+	window_text(str);
+
+	progress_set_file(str);
+	progress_set_direction(true);
+	progress_show(true);
+}
+
+static void do_download(void)
+{
 	if (pstate != STATE_OPEN) return;
 
 	busy_cursor();
@@ -242,13 +398,7 @@ static void do_download(void)
 		SetCursor(&arrow);
 	} else {
 		if (transfer_start(scsi_id)) {
-			pstate = STATE_DOWNLOAD;
-			str_load(STR_GENERAL, STRI_GEN_DOWNLOAD, str, 16);
-			window_text(str);
-
-			progress_set_file(str);
-			progress_set_direction(true);
-			progress_show(true);
+			do_download_show();
 		} else {
 			/* failed to start the transfer */
 			SetCursor(&arrow);
@@ -256,8 +406,38 @@ static void do_download(void)
 	}
 }
 
+static void do_download_range(void)
+{
+	Str63 name;
+	long offset, length, size;
+	short i, index;
+
+	if (pstate != STATE_OPEN || open_type) return;
+
+	i = 0;
+	window_next(&i);
+	if (i < 0 || ! emu_get_info(i, &index, &size) || size <= 0) {
+		SysBeep(1);
+		return;
+	}
+	window_get_item_name(i, name);
+	if (dialog_range(name, size, &offset, &length)
+			&& transfer_start_range(scsi_id, i, offset, length)) {
+		do_download_show();
+	}
+}
+
 static void do_quit(void)
 {
+	/* the mounted image needs this program to be read */
+	if (! vdisk_unmount(false)) return;
+	do_xfer_stop();
+	ExitToShell();
+}
+
+static void do_fatal(void)
+{
+	vdisk_unmount(true);
 	do_xfer_stop();
 	ExitToShell();
 }
@@ -288,6 +468,16 @@ static void do_menu_command(long menu_key)
 			do_open();
 		} else if (menu_item == MENUI_UPLOAD) {
 			do_upload();
+		} else if (menu_item == MENUI_UPLOAD_VOL) {
+			do_upload_volume();
+		} else if (menu_item == MENUI_RANGE) {
+			do_download_range();
+		} else if (menu_item == MENUI_PREVIEW) {
+			do_preview();
+		} else if (menu_item == MENUI_BROWSE) {
+			do_browse();
+		} else if (menu_item == MENUI_MOUNT) {
+			do_mount();
 		} else if (menu_item == MENUI_QUIT) {
 			do_quit();
 		}
@@ -296,6 +486,26 @@ static void do_menu_command(long menu_key)
 		/* delegate to DA, we don't use these */
 		SystemEdit(menu_item);
 		break;
+	case MENU_OPTIONS:
+		if (menu_item == MENUI_VERIFY) {
+			g_verify_upload = ! g_verify_upload;
+			CheckItem(GetMHandle(MENU_OPTIONS), MENUI_VERIFY, g_verify_upload);
+		} else if (menu_item == MENUI_MACBIN) {
+			g_decode_macbin = ! g_decode_macbin;
+			CheckItem(GetMHandle(MENU_OPTIONS), MENUI_MACBIN, g_decode_macbin);
+		} else if (menu_item == MENUI_BINHEX) {
+			g_decode_binhex = ! g_decode_binhex;
+			CheckItem(GetMHandle(MENU_OPTIONS), MENUI_BINHEX, g_decode_binhex);
+		} else if (menu_item == MENUI_UP_MACBIN) {
+			g_upload_macbin = ! g_upload_macbin;
+			CheckItem(GetMHandle(MENU_OPTIONS), MENUI_UP_MACBIN, g_upload_macbin);
+		} else if (menu_item == MENUI_WATCH) {
+			g_watch_device = ! g_watch_device;
+			CheckItem(GetMHandle(MENU_OPTIONS), MENUI_WATCH, g_watch_device);
+			watch_last = TickCount();
+			watch_back = 0;
+		}
+		break;
 	}
 
 	HiliteMenu(0);
@@ -490,12 +700,12 @@ int main(void)
 	long i;
 	EventRecord evt;
 
-	if (! init_program(do_quit, 2)) {
+	if (! init_program(do_fatal, 2)) {
 		return 128;
 	}
 
 	/*
-	 * Set early to avoid an unsafe do_quit()
+	 * Set early to avoid an unsafe do_fatal()
 	 */
 	pstate = STATE_IDLE;
 	menu_state = pstate;
@@ -534,7 +744,7 @@ int main(void)
 	while (true) {
 
 		if (g_use_wne) {
-			if (!WaitNextEvent(everyEvent, &evt, WAIT_EVENT_SLEEP, 0L)) {
+			if (!WaitNextEvent(everyEvent, &evt, peeking ? 0 : WAIT_EVENT_SLEEP, 0L)) {
 				evt_null();
 				continue;
 			}
@@ -0,0 +1,249 @@
+/*
+ * Copyright (C) 2026 saybur
+ *
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this
+ * program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "names.h"
+#include "util.h"
+
+/*
+ * This compilation unit implements a small hashed index of file names, used to
+ * answer "does this name already exist?" without walking a list or asking the File
+ * Manager once per name.
+ *
+ * Names are folded with UprString() before being hashed or stored, ignoring both
+ * case and diacriticals. That matches EqualString(a, b, false, false), which is how
+ * name comparisons were made before this existed. The folded names are kept packed
+ * one after another in a single handle, and each entry records where its name
+ * starts, the value it maps to, and the next entry in the same bucket.
+ */
+
+typedef struct {
+	long offset;
+	short value;
+	short next;
+} NameEntry;
+
+/* how many entries to grow the entry table by when it fills */
+#define NAMES_GROW  32
+
+/**
+ * Copies a name into the given storage, folded for comparison.
+ *
+ * @param name  the Pascal string to fold.
+ * @param key   storage for the folded string, at least 64 bytes.
+ */
+static void names_fold(unsigned char *name, unsigned char *key)
+{
+	short len;
+
+	len = name[0];
+	if (len > 63) len = 63;
+	BlockMove(&(name[1]), &(key[1]), len);
+	key[0] = len;
+	UprString(key, false);
+}
+
+/**
+ * @param key  a folded name from names_fold().
+ * @return     the bucket the name belongs in.
+ */
+static short names_hash(unsigned char *key)
+{
+	unsigned short h;
+	short i;
+
+	h = 0;
+	for (i = 1; i <= key[0]; i++) {
+		h = (h << 3) + h + key[i];
+	}
+	return h % NAMES_BUCKETS;
+}
+
+/**
+ * Allocates a new, empty index. This will not return if memory is exhausted.
+ *
+ * @return  the new index, to be released with names_dispose().
+ */
+NameIndex *names_new(void)
+{
+	NameIndex *idx;
+
+	if (! (idx = (NameIndex *) NewPtr(sizeof(NameIndex)))) {
+		mem_fail();
+	}
+	if (! (idx->entries = NewHandle(NAMES_GROW * sizeof(NameEntry)))) {
+		mem_fail();
+	}
+	if (! (idx->strs = NewHandle(NAMES_GROW * 16))) {
+		mem_fail();
+	}
+	names_clear(idx);
+	return idx;
+}
+
+/**
+ * Releases an index made with names_new().
+ *
+ * @param idx  the index to release, may be null.
+ */
+void names_dispose(NameIndex *idx)
+{
+	if (! idx) return;
+	DisposHandle(idx->entries);
+	DisposHandle(idx->strs);
+	DisposPtr((Ptr) idx);
+}
+
+/**
+ * Removes all names from the index. Storage is kept for reuse.
+ *
+ * @param idx  the index to clear.
+ */
+void names_clear(NameIndex *idx)
+{
+	short i;
+
+	idx->count = 0;
+	idx->strs_len = 0;
+	for (i = 0; i < NAMES_BUCKETS; i++) {
+		idx->buckets[i] = -1;
+	}
+}
+
+/**
+ * Adds a name to the index. Adding a name that is already present is allowed; the
+ * most recently added value is the one names_find() will report.
+ *
+ * @param idx    the index to add to.
+ * @param name   the Pascal string name.
+ * @param value  the non-negative value to associate with the name.
+ */
+void names_add(NameIndex *idx, unsigned char *name, short value)
+{
+	Str63 key;
+	short b;
+	long need;
+	NameEntry *e;
+
+	names_fold(name, key);
+
+	/* grow storage as needed */
+	need = (long) (idx->count + 1) * sizeof(NameEntry);
+	if (GetHandleSize(idx->entries) < need) {
+		SetHandleSize(idx->entries, need + NAMES_GROW * sizeof(NameEntry));
+		if (MemError()) mem_fail();
+	}
+	need = idx->strs_len + key[0] + 1;
+	if (GetHandleSize(idx->strs) < need) {
+		SetHandleSize(idx->strs, need + NAMES_GROW * 16);
+		if (MemError()) mem_fail();
+	}
+
+	BlockMove(key, *(idx->strs) + idx->strs_len, key[0] + 1);
+
+	b = names_hash(key);
+	e = ((NameEntry *) *(idx->entries)) + idx->count;
+	e->offset = idx->strs_len;
+	e->value = value;
+	e->next = idx->buckets[b];
+	idx->buckets[b] = idx->count;
+
+	idx->strs_len += key[0] + 1;
+	idx->count++;
+}
+
+/**
+ * Looks up a name in the index.
+ *
+ * @param idx   the index to search.
+ * @param name  the Pascal string name to find.
+ * @return      the value stored with the name, or -1 if it is not present.
+ */
+short names_find(NameIndex *idx, unsigned char *name)
+{
+	Str63 key;
+	short i;
+	unsigned char *s;
+	NameEntry *e;
+
+	names_fold(name, key);
+
+	i = idx->buckets[names_hash(key)];
+	while (i >= 0) {
+		e = ((NameEntry *) *(idx->entries)) + i;
+		s = (unsigned char *) *(idx->strs) + e->offset;
+		if (s[0] == key[0] && str_eq((char *) &(s[1]), (char *) &(key[1]), key[0])) {
+			return e->value;
+		}
+		i = e->next;
+	}
+	return -1;
+}
+
+/**
+ * Clears the index and fills it with every name in a directory, files and folders
+ * both, as either will stop a file of the same name from being created. Names are
+ * stored with their position in the directory as the value.
+ *
+ * This reads the catalog once, in order, rather than looking up names one at a
+ * time. Volumes without PBGetCatInfo() support (MFS) fall back to PBGetFInfo(),
+ * which only has files to report there anyway.
+ *
+ * @param idx   the index to fill.
+ * @param vref  the volume or working directory reference to read.
+ * @return      zero on success, otherwise the OSErr that stopped the read.
+ */
+short names_load_dir(NameIndex *idx, short vref)
+{
+	CInfoPBRec cpb;
+	ParamBlockRec pb;
+	Str63 name;
+	short i, err;
+	Boolean cat;
+
+	names_clear(idx);
+
+	cat = true;
+	for (i = 1; ; i++) {
+		if (cat) {
+			cpb.hFileInfo.ioCompletion = 0;
+			cpb.hFileInfo.ioNamePtr = name;
+			cpb.hFileInfo.ioVRefNum = vref;
+			cpb.hFileInfo.ioFDirIndex = i;
+			cpb.hFileInfo.ioDirID = 0; /* overwritten on each call */
+			err = PBGetCatInfo(&cpb, false);
+			if (err == paramErr && i == 1) {
+				cat = false;
+				i = 0;
+				continue;
+			}
+		} else {
+			pb.fileParam.ioCompletion = 0;
+			pb.fileParam.ioNamePtr = name;
+			pb.fileParam.ioVRefNum = vref;
+			pb.fileParam.ioFVersNum = 0;
+			pb.fileParam.ioFDirIndex = i;
+			err = PBGetFInfo(&pb, false);
+		}
+
+		if (err == fnfErr) {
+			/* ran off the end of the directory */
+			return 0;
+		} else if (err) {
+			return err;
+		}
+		names_add(idx, name, i);
+	}
+}
@@ -0,0 +1,37 @@
+/*
+ * Copyright (C) 2026 saybur
+ *
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this
+ * program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __NAMESH__
+#define __NAMESH__
+
+#define NAMES_BUCKETS  128
+
+typedef struct {
+	short count;
+	long strs_len;
+	Handle entries;
+	Handle strs;
+	short buckets[NAMES_BUCKETS];
+} NameIndex;
+
+NameIndex *names_new(void);
+void names_dispose(NameIndex *idx);
+void names_clear(NameIndex *idx);
+void names_add(NameIndex *idx, unsigned char *name, short value);
+short names_find(NameIndex *idx, unsigned char *name);
+short names_load_dir(NameIndex *idx, short vref);
+
+#endif /* __NAMESH__ */
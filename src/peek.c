@@ -0,0 +1,188 @@
+/*
+ * Copyright (C) 2026 saybur
+ *
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this
+ * program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "constants.h"
+#include "emu.h"
+#include "macbin.h"
+#include "peek.h"
+#include "scsi.h"
+#include "types.h"
+#include "util.h"
+#include "window.h"
+
+/*
+ * This compilation unit looks at the start of files in the listing to find out what
+ * they are before they are downloaded. The main loop calls in here for a few files
+ * at a time while nothing else is happening, so the type and creator of the files
+ * in view fill in gradually and never hold up a transfer. Results are kept until the
+ * listing is reloaded, and follow their rows when a refresh only adds or removes a
+ * few, see emu_populate_list().
+ *
+ * Problems reading a file are not reported, as the user did not ask for anything;
+ * the file is just left without a type. The exception is UNIT ATTENTION, which is
+ * passed back so the listing can be reloaded, since reading the sense data has
+ * cleared it and nothing else would find out the card was changed.
+ */
+
+#define PEEK_HEAD_SIZE  512
+
+/* where the primary volume descriptor of an ISO 9660 image is, in 4K blocks */
+#define PEEK_ISO_BLOCK  8
+#define PEEK_ISO_LEN    6
+
+static Boolean done[MAXIMUM_FILES];
+static long types[MAXIMUM_FILES];
+static long creators[MAXIMUM_FILES];
+
+/**
+ * Forgets everything found so far, for when the listing changes.
+ */
+void peek_clear(void)
+{
+	short i;
+
+	for (i = 0; i < MAXIMUM_FILES; i++) {
+		done[i] = false;
+	}
+}
+
+/**
+ * Forgets what was found for one item, for when the file it stands for has changed.
+ *
+ * @param item  the item number in the listing.
+ */
+void peek_forget(short item)
+{
+	if (item < 0 || item >= MAXIMUM_FILES) return;
+	done[item] = false;
+}
+
+/**
+ * Moves what was found for the items at and after the given one, for when rows are
+ * added to or removed from the listing without reloading all of it.
+ *
+ * @param item  the item number of the first row added or removed.
+ * @param by    1 if a row was added there, -1 if it was removed.
+ */
+void peek_shift(short item, short by)
+{
+	short i;
+
+	if (item < 0 || item >= MAXIMUM_FILES) return;
+	if (by > 0) {
+		for (i = MAXIMUM_FILES - 1; i > item; i--) {
+			done[i] = done[i - 1];
+			types[i] = types[i - 1];
+			creators[i] = creators[i - 1];
+		}
+		done[item] = false;
+	} else {
+		for (i = item; i < MAXIMUM_FILES - 1; i++) {
+			done[i] = done[i + 1];
+			types[i] = types[i + 1];
+			creators[i] = creators[i + 1];
+		}
+		done[MAXIMUM_FILES - 1] = false;
+	}
+}
+
+/**
+ * @param item  the item number in the listing.
+ * @return      true if the item has been looked at, whether or not a type was found.
+ */
+Boolean peek_done(short item)
+{
+	if (item < 0 || item >= MAXIMUM_FILES) return true;
+	return done[item];
+}
+
+/**
+ * Gets the type and creator found for an item.
+ *
+ * @param item     the item number in the listing.
+ * @param type     set to the type.
+ * @param creator  set to the creator.
+ * @return         true if the item has been looked at and a type was found.
+ */
+Boolean peek_get(short item, long *type, long *creator)
+{
+	if (item < 0 || item >= MAXIMUM_FILES || ! done[item] || ! types[item]) {
+		return false;
+	}
+	*type = types[item];
+	*creator = creators[item];
+	return true;
+}
+
+/**
+ * Reads the first block of an item from the device and works out its type and
+ * creator. MacBinary files give the type and creator of the file inside. Files that
+ * are not otherwise recognized get a second small read to look for an ISO 9660
+ * volume descriptor.
+ *
+ * @param scsi  the SCSI ID of the device.
+ * @param item  the item number in the listing.
+ * @return      the error if the device reported UNIT ATTENTION, otherwise zero.
+ */
+long peek_fetch(short scsi, short item)
+{
+	char head[PEEK_HEAD_SIZE], vd[PEEK_ISO_LEN];
+	ForkInfo info;
+	Str63 name;
+	long size, dstart, rstart, err;
+	short index, len, i;
+
+	if (item < 0 || item >= MAXIMUM_FILES) return 0;
+	done[item] = true;
+	types[item] = 0;
+	creators[item] = 0;
+	if (! emu_get_info(item, &index, &size) || size <= 0) return 0;
+
+	for (i = 0; i < PEEK_HEAD_SIZE; i++) {
+		head[i] = 0;
+	}
+	len = (size < PEEK_HEAD_SIZE ? (short) size : PEEK_HEAD_SIZE);
+	if (err = scsi_read_file_bytes(scsi, index, 0, head, len)) {
+		return (scsi_is_attention(err) ? err : 0);
+	}
+
+	if (macbin_parse((unsigned char *) head, size, &info, &dstart, &rstart)) {
+		types[item] = info.type;
+		creators[item] = info.creator;
+		return 0;
+	}
+	if (types_magic(head, &(types[item]), &(creators[item]))) {
+		return 0;
+	}
+
+	if (size >= PEEK_ISO_BLOCK * 4096L + 2048L) {
+		if (err = scsi_read_file_bytes(scsi, index, PEEK_ISO_BLOCK, vd, PEEK_ISO_LEN)) {
+			if (scsi_is_attention(err)) return err;
+		} else if (vd[0] == 0x01 && str_eq(&(vd[1]), "CD001", 5)) {
+			types[item] = 'ISO ';
+			creators[item] = '????';
+			return 0;
+		}
+	}
+
+	/* last, fall back on the name */
+	window_get_item_name(item, name);
+	types_find(head, name, &(types[item]), &(creators[item]));
+	if (types[item] == '????') {
+		types[item] = 0;
+	}
+	return 0;
+}
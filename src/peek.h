@@ -0,0 +1,27 @@
+/*
+ * Copyright (C) 2026 saybur
+ *
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this
+ * program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __PEEKH__
+#define __PEEKH__
+
+void peek_clear(void);
+void peek_forget(short item);
+void peek_shift(short item, short by);
+Boolean peek_done(short item);
+Boolean peek_get(short item, long *type, long *creator);
+long peek_fetch(short scsi, short item);
+
+#endif /* __PEEKH__ */
@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2026 saybur
+ *
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this
+ * program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include "emu.h"
+#include "prefetch.h"
+#include "scsi.h"
+
+/*
+ * This compilation unit reads the start of the selected file while the program is
+ * otherwise idle, on the assumption that it is about to be downloaded. When the
+ * download does start, transfer.c takes the first chunk from here instead of going
+ * to the device, so the local file can be created with the right type and the first
+ * buffer written straight away.
+ *
+ * Only one file is kept at a time. Anything read is thrown away as soon as the
+ * selection changes, and nothing is done unless exactly one file is selected. As
+ * with peek.c, read errors are not reported, other than UNIT ATTENTION; the download
+ * just reads the data itself as usual.
+ */
+
+#define PREFETCH_BLK_SIZE  4096L
+#define PREFETCH_BLOCKS    4    /* 4 * 4K = 16K */
+
+static Ptr pdata;
+static Boolean pdone;
+static short pitem = -1;
+static short pindex;
+static long psize, plen;
+
+/**
+ * Throws away anything held for the current item.
+ */
+static void prefetch_discard(void)
+{
+	if (pdata) {
+		DisposPtr(pdata);
+		pdata = 0;
+	}
+	plen = 0;
+}
+
+/**
+ * Called when the selection in the listing changes. If a different item is now
+ * selected, anything read for the old one is dropped and the new one is read on a
+ * later call to prefetch_idle().
+ *
+ * @param item  the single selected item number, or -1 if there is not exactly one
+ *              file selected.
+ */
+void prefetch_select(short item)
+{
+	if (item == pitem) return;
+	prefetch_discard();
+	pitem = item;
+	pdone = false;
+}
+
+/**
+ * Called while the program is idle to read the start of the selected file, if that
+ * has not already been done.
+ *
+ * @param scsi  the SCSI ID of the device.
+ * @param ferr  set to the error if the device reported UNIT ATTENTION, otherwise
+ *              zero; the listing must then be reloaded.
+ * @return      true if a read was done this call, false if there was nothing to do.
+ */
+Boolean prefetch_idle(short scsi, long *ferr)
+{
+	long err;
+	short blks;
+
+	*ferr = 0;
+	if (pitem < 0 || pdone) return false;
+	pdone = true;
+
+	if (! emu_get_info(pitem, &pindex, &psize) || psize <= 0) return false;
+	if (! (pdata = NewPtr(PREFETCH_BLOCKS * PREFETCH_BLK_SIZE))) return false;
+
+	/* read whole blocks only, unless the entire file is less than one block */
+	if (psize < PREFETCH_BLK_SIZE) {
+		plen = psize;
+		err = scsi_read_file_bytes(scsi, pindex, 0, pdata, (short) plen);
+	} else {
+		blks = (psize > PREFETCH_BLOCKS * PREFETCH_BLK_SIZE
+				? PREFETCH_BLOCKS : (short) (psize / PREFETCH_BLK_SIZE));
+		if (blks > 1 && config_has_capability(scsi, CAP_LARGE_RECEIVE)) {
+			err = scsi_read_file_blocks(scsi, pindex, 0, pdata, &blks);
+		} else {
+			blks = 1;
+			err = scsi_read_file_bytes(scsi, pindex, 0, pdata,
+					(short) PREFETCH_BLK_SIZE);
+		}
+		plen = blks * PREFETCH_BLK_SIZE;
+	}
+	if (err) {
+		prefetch_discard();
+		if (scsi_is_attention(err)) {
+			*ferr = err;
+		}
+	}
+	return true;
+}
+
+/**
+ * Hands over the start of a file if it has already been read, releasing it. Only
+ * whole 4K blocks are given, unless the file is smaller than one block, in which
+ * case all of it is.
+ *
+ * @param index  the file index from the listing, see emu_get_info().
+ * @param size   the size of the file.
+ * @param buf    the buffer to copy into, starting at the beginning of the file.
+ * @param max    the most that may be copied.
+ * @return       the number of bytes copied, or 0 if nothing was available.
+ */
+long prefetch_take(short index, long size, char *buf, long max)
+{
+	long len;
+
+	if (! pdata || index != pindex || size != psize) return 0;
+
+	len = (plen < max ? plen : max);
+	if (size >= PREFETCH_BLK_SIZE) {
+		len -= len % PREFETCH_BLK_SIZE;
+	}
+	if (len > 0) {
+		BlockMove(pdata, buf, len);
+	}
+	prefetch_discard();
+	return len;
+}
@@ -0,0 +1,504 @@
+/*
+ * Copyright (C) 2026 saybur
+ *
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this
+ * program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "constants.h"
+#include "dialog.h"
+#include "emu.h"
+#include "preview.h"
+#include "scsi.h"
+#include "util.h"
+#include "window.h"
+
+/*
+ * This compilation unit shows the start of a file on the device in a modal dialog,
+ * as text or as a hex dump, without downloading it. The first couple of 4K blocks
+ * are read when the dialog opens, and more are read as the user scrolls towards the
+ * end of what has been read, up to a limit. Nothing is written to disk.
+ *
+ * Text is shown in Monaco with CR, LF and CR LF all ending lines, and long lines
+ * wrapped at the width of the view. Lines are found by scanning the data; to keep
+ * memory use down only the start of every PREVIEW_MARK'th line is kept, and a line
+ * is found by scanning forward from the nearest one.
+ */
+
+#define PREVIEW_DONE    1
+#define PREVIEW_TEXT    2
+#define PREVIEW_HEX     3
+#define PREVIEW_VIEW    4
+#define PREVIEW_NAME    5
+#define PREVIEW_BORDER  6
+
+#define PREVIEW_BLOCK   4096L
+#define PREVIEW_FIRST   2
+#define PREVIEW_MAX     65536L
+
+/* bytes on each line of the hex dump */
+#define PREVIEW_HEX_LEN 16
+
+/* line starts are kept for every this many lines */
+#define PREVIEW_MARK    16
+
+static short scsi_id, findex, fitem;
+static long fsize, dlen;
+static Handle data, marks;
+static long nlines, top;
+static short rows, cols, lheight, ascent;
+static Boolean hex;
+static ControlHandle bar;
+static Rect vrect;
+
+/**
+ * Finds where the line after the one starting at pos begins, in text mode.
+ *
+ * @param pos  the start of a line.
+ * @return     the start of the next line, or dlen if there is none.
+ */
+static long preview_next(long pos)
+{
+	unsigned char *d;
+	short col;
+
+	d = (unsigned char *) *data;
+	for (col = 0; pos < dlen && col < cols; col++) {
+		if (d[pos] == 0x0D) {
+			pos++;
+			if (pos < dlen && d[pos] == 0x0A) pos++;
+			return pos;
+		} else if (d[pos] == 0x0A) {
+			return pos + 1;
+		}
+		pos++;
+	}
+	return pos;
+}
+
+/**
+ * Counts the lines in the data and notes where every PREVIEW_MARK'th one starts.
+ * The scroll bar is updated to match.
+ */
+static void preview_lines(void)
+{
+	long pos, n;
+
+	if (hex) {
+		nlines = (dlen + PREVIEW_HEX_LEN - 1) / PREVIEW_HEX_LEN;
+	} else {
+		SetHandleSize(marks, 0);
+		HLock(data);
+		nlines = 0;
+		for (pos = 0; pos < dlen; pos = preview_next(pos)) {
+			if (nlines % PREVIEW_MARK == 0) {
+				n = nlines / PREVIEW_MARK;
+				SetHandleSize(marks, (n + 1) * sizeof(long));
+				if (MemError()) {
+					mem_fail();
+				}
+				((long *) *marks)[n] = pos;
+			}
+			nlines++;
+		}
+		HUnlock(data);
+	}
+
+	n = nlines - rows;
+	if (n < 0) n = 0;
+	if (n > 32767) n = 32767;
+	SetCtlMax(bar, (short) n);
+	if (top > n) top = n;
+}
+
+/**
+ * Finds where a line starts, in text mode.
+ *
+ * @param line  the line number.
+ * @return      the offset of the line in the data.
+ */
+static long preview_start(long line)
+{
+	long pos, n;
+
+	pos = ((long *) *marks)[line / PREVIEW_MARK];
+	for (n = line % PREVIEW_MARK; n > 0; n--) {
+		pos = preview_next(pos);
+	}
+	return pos;
+}
+
+/**
+ * Puts a byte in a string as two hex digits.
+ */
+static void preview_hex_byte(unsigned char *s, unsigned char b)
+{
+	s[++s[0]] = "0123456789ABCDEF"[b >> 4];
+	s[++s[0]] = "0123456789ABCDEF"[b & 0x0F];
+}
+
+/**
+ * Builds one line of the view.
+ *
+ * @param line  the line number.
+ * @param s     set to the text of the line.
+ */
+static void preview_line(long line, unsigned char *s)
+{
+	unsigned char *d;
+	long pos, end, i;
+	unsigned char c;
+
+	d = (unsigned char *) *data;
+	s[0] = 0;
+	if (hex) {
+		pos = line * PREVIEW_HEX_LEN;
+		for (i = 24; i >= 0; i -= 8) {
+			preview_hex_byte(s, (unsigned char) (pos >> i));
+		}
+		s[++s[0]] = ' ';
+		for (i = 0; i < PREVIEW_HEX_LEN; i++) {
+			s[++s[0]] = ' ';
+			if (pos + i < dlen) {
+				preview_hex_byte(s, d[pos + i]);
+			} else {
+				s[++s[0]] = ' ';
+				s[++s[0]] = ' ';
+			}
+		}
+		s[++s[0]] = ' ';
+		s[++s[0]] = ' ';
+		for (i = 0; i < PREVIEW_HEX_LEN && pos + i < dlen; i++) {
+			c = d[pos + i];
+			s[++s[0]] = (c < 0x20 || c == 0x7F ? '.' : c);
+		}
+	} else {
+		pos = preview_start(line);
+		end = preview_next(pos);
+		for (; pos < end && s[0] < 255; pos++) {
+			c = d[pos];
+			if (c == 0x0D || c == 0x0A) break;
+			s[++s[0]] = (c < 0x20 || c == 0x7F ? ' ' : c);
+		}
+	}
+}
+
+/**
+ * Draws the visible lines and the frame around them.
+ *
+ * @param w  the dialog.
+ * @param i  the item number of the view.
+ */
+pascal static void preview_draw(WindowPtr w, short i)
+{
+	Str255 s;
+	Rect r;
+	RgnHandle clip;
+	short row, font, size;
+
+	r = vrect;
+	InsetRect(&r, -1, -1);
+	FrameRect(&r);
+
+	r = vrect;
+	r.right -= 15;
+	EraseRect(&r);
+	clip = NewRgn();
+	GetClip(clip);
+	ClipRect(&r);
+	font = thePort->txFont;
+	size = thePort->txSize;
+	TextFont(monaco);
+	TextSize(9);
+
+	HLock(data);
+	for (row = 0; row < rows && top + row < nlines; row++) {
+		preview_line(top + row, s);
+		MoveTo(r.left + 4, r.top + 2 + row * lheight + ascent);
+		DrawString(s);
+	}
+	HUnlock(data);
+
+	TextFont(font);
+	TextSize(size);
+	SetClip(clip);
+	DisposeRgn(clip);
+}
+
+/**
+ * Shows the name of the file and how much of it has been read. This uses
+ * ParamText(), which alerts also use, so it is called again after those.
+ *
+ * @param d  the dialog.
+ */
+static void preview_name(DialogPtr d)
+{
+	Str63 name;
+	Str15 got, total;
+	short item_type;
+	Handle item_handle;
+	Rect rect;
+
+	window_get_item_name(fitem, name);
+	NumToString(dlen, got);
+	NumToString(fsize, total);
+	ParamText(name, got, total, 0);
+	GetDItem(d, PREVIEW_NAME, &item_type, &item_handle, &rect);
+	InvalRect(&rect);
+}
+
+/**
+ * Reads the next block of the file, if there is more to read and the limit has not
+ * been reached. Problems are reported to the user, and stop any more reads.
+ *
+ * @return  true if more was read.
+ */
+static Boolean preview_fetch(void)
+{
+	long len, err;
+
+	if (dlen >= fsize || dlen >= PREVIEW_MAX) return false;
+
+	len = fsize - dlen;
+	if (len > PREVIEW_BLOCK) len = PREVIEW_BLOCK;
+	SetHandleSize(data, dlen + len);
+	if (MemError()) {
+		mem_fail();
+	}
+
+	busy_cursor();
+	HLock(data);
+	err = scsi_read_file_bytes(scsi_id, findex, dlen / PREVIEW_BLOCK,
+			*data + dlen, (short) len);
+	HUnlock(data);
+	SetCursor(&arrow);
+	if (err) {
+		SetHandleSize(data, dlen);
+		fsize = dlen;
+		scsi_alert(err);
+		return false;
+	}
+	dlen += len;
+	return true;
+}
+
+/**
+ * Scrolls the view, reading more of the file when the end of what has been read
+ * comes into view.
+ *
+ * @param d     the dialog.
+ * @param line  the new top line.
+ */
+static void preview_scroll(DialogPtr d, long line)
+{
+	Boolean more;
+
+	more = false;
+	while (line + rows >= nlines && preview_fetch()) {
+		more = true;
+		preview_lines();
+	}
+	if (more) {
+		preview_name(d);
+	}
+
+	if (line > GetCtlMax(bar)) line = GetCtlMax(bar);
+	if (line < 0) line = 0;
+	if (line == top && ! more) return;
+	top = line;
+	SetCtlValue(bar, (short) top);
+	preview_draw(d, PREVIEW_VIEW);
+}
+
+/**
+ * Action procedure for the scroll bar arrows and page areas.
+ */
+pascal static void preview_track(ControlHandle ch, short part)
+{
+	long line;
+
+	line = top;
+	if (part == inUpButton) {
+		line--;
+	} else if (part == inDownButton) {
+		line++;
+	} else if (part == inPageUp) {
+		line -= rows - 1;
+	} else if (part == inPageDown) {
+		line += rows - 1;
+	} else {
+		return;
+	}
+	preview_scroll((DialogPtr) (**ch).contrlOwner, line);
+}
+
+/**
+ * Filter for ModalDialog() that handles the scroll bar and the scrolling keys.
+ * Return and Enter count as the Done button.
+ */
+pascal static Boolean preview_filter(DialogPtr d, EventRecord *evt, short *item)
+{
+	ControlHandle ch;
+	Point p;
+	short part;
+	char c;
+
+	SetPort(d);
+	if (evt->what == mouseDown) {
+		p = evt->where;
+		GlobalToLocal(&p);
+		part = FindControl(p, d, &ch);
+		if (ch == bar && part) {
+			if (part == inThumb) {
+				TrackControl(bar, p, 0L);
+				preview_scroll(d, GetCtlValue(bar));
+			} else {
+				TrackControl(bar, p, (ProcPtr) preview_track);
+			}
+			*item = PREVIEW_VIEW;
+			return true;
+		}
+	} else if (evt->what == keyDown || evt->what == autoKey) {
+		c = evt->message & charCodeMask;
+		*item = PREVIEW_VIEW;
+		if (c == 0x0D || c == 0x03) {
+			*item = PREVIEW_DONE;
+		} else if (c == 0x1E) {
+			preview_scroll(d, top - 1);
+		} else if (c == 0x1F) {
+			preview_scroll(d, top + 1);
+		} else if (c == 0x0B) {
+			preview_scroll(d, top - (rows - 1));
+		} else if (c == 0x0C) {
+			preview_scroll(d, top + (rows - 1));
+		} else if (c == 0x01) {
+			preview_scroll(d, 0);
+		} else if (c == 0x04) {
+			preview_scroll(d, nlines);
+		}
+		return true;
+	}
+	return false;
+}
+
+/**
+ * Switches between text and hex, going back to the top.
+ *
+ * @param d   the dialog.
+ * @param to  true for hex, false for text.
+ */
+static void preview_mode(DialogPtr d, Boolean to)
+{
+	short item_type;
+	Handle item_handle;
+	Rect rect;
+
+	hex = to;
+	GetDItem(d, PREVIEW_TEXT, &item_type, &item_handle, &rect);
+	SetCtlValue((ControlHandle) item_handle, ! hex);
+	GetDItem(d, PREVIEW_HEX, &item_type, &item_handle, &rect);
+	SetCtlValue((ControlHandle) item_handle, hex);
+
+	top = 0;
+	preview_lines();
+	SetCtlValue(bar, 0);
+	preview_draw(d, PREVIEW_VIEW);
+}
+
+/**
+ * Shows the start of a file in the file list, reading more as the user scrolls.
+ * Returns once the user is done.
+ *
+ * @param scsi  the SCSI ID of the device.
+ * @param item  the item in the file list.
+ */
+void preview_file(short scsi, short item)
+{
+	DialogPtr dialog;
+	FontInfo fi;
+	short item_hit, item_type, i, font, size;
+	Handle item_handle;
+	Rect rect;
+
+	if (! emu_get_info(item, &findex, &fsize)) {
+		alert_template(0, ALRT_GENERIC, STRI_GA_NSF);
+		return;
+	}
+	scsi_id = scsi;
+	fitem = item;
+	dlen = 0;
+	top = 0;
+	nlines = 0;
+	hex = false;
+	if (! (data = NewHandle(0))) {
+		mem_fail();
+	}
+	if (! (marks = NewHandle(0))) {
+		mem_fail();
+	}
+
+	dialog = GetNewDialog(DLOG_PREVIEW, 0L, (WindowPtr) -1);
+	if (! dialog) {
+		mem_fail();
+	}
+	SetPort(dialog);
+
+	/* size the view for Monaco 9 */
+	font = thePort->txFont;
+	size = thePort->txSize;
+	TextFont(monaco);
+	TextSize(9);
+	GetFontInfo(&fi);
+	lheight = fi.ascent + fi.descent + fi.leading;
+	ascent = fi.ascent;
+	i = CharWidth('0');
+	TextFont(font);
+	TextSize(size);
+
+	GetDItem(dialog, PREVIEW_VIEW, &item_type, &item_handle, &vrect);
+	SetDItem(dialog, PREVIEW_VIEW, item_type, (Handle) preview_draw, &vrect);
+	rows = (vrect.bottom - vrect.top - 4) / lheight;
+	cols = (vrect.right - vrect.left - 15 - 8) / i;
+
+	rect = vrect;
+	rect.left = rect.right - 16;
+	rect.top -= 1;
+	rect.bottom += 1;
+	rect.right += 1;
+	bar = NewControl(dialog, &rect, "\p", true, 0, 0, 0, scrollBarProc, 0L);
+	if (! bar) {
+		mem_fail();
+	}
+
+	GetDItem(dialog, PREVIEW_TEXT, &item_type, &item_handle, &rect);
+	SetCtlValue((ControlHandle) item_handle, true);
+	GetDItem(dialog, PREVIEW_BORDER, &item_type, &item_handle, &rect);
+	SetDItem(dialog, PREVIEW_BORDER, item_type, (Handle) dialog_default_border, &rect);
+
+	for (i = 0; i < PREVIEW_FIRST && preview_fetch(); i++) ;
+	preview_lines();
+	preview_name(dialog);
+	ShowWindow(dialog);
+	do {
+		ModalDialog((ModalFilterProcPtr) preview_filter, &item_hit);
+
+		if (item_hit == PREVIEW_TEXT) {
+			preview_mode(dialog, false);
+		} else if (item_hit == PREVIEW_HEX) {
+			preview_mode(dialog, true);
+		}
+	} while (item_hit != PREVIEW_DONE);
+
+	DisposDialog(dialog);
+	DisposHandle(marks);
+	DisposHandle(data);
+}
@@ -52,6 +52,11 @@
  * 0x05: SCSIComplete
  * 0x06: status was not COMMAND COMPLETE, in the low word, the high byte is the
  *       message and the low byte is SCSI status
+ * 0x08: target did not complete the command in time and the bus was reset; low
+ *       word is the SCSIComplete error
+ * 0x09: CHECK CONDITION with UNIT ATTENTION, meaning the device was reset or had
+ *       its media changed; low word is the ASC/ASCQ. The condition has already
+ *       been cleared by the time the caller sees this.
  */
 
 #define TOOLBOX_MODE_PAGE       0x31
@@ -65,6 +70,34 @@
 
 /* common responses to REQUEST SENSE */
 #define SENSE_INVALID_FIELD_CDB 0x00052400L
+#define SENSE_KEY_UNIT_ATTN     0x06
+
+/* command classes for latency tracking, see scsi_timeout() */
+#define SCSI_CLASS_QUERY    0
+#define SCSI_CLASS_READ     1
+#define SCSI_CLASS_WRITE    2
+#define SCSI_CLASS_CONTROL  3
+#define SCSI_CLASSES        4
+
+/* latency samples are normalized to this many bytes */
+#define SCSI_UNIT_SIZE      4096L
+/* samples needed before the observed latency is trusted */
+#define SCSI_SAMPLES_MIN    4
+
+/* smoothed completion latency per ID and class, in 1/8 ticks per unit */
+static short lat_mean[7][SCSI_CLASSES];
+static short lat_dev[7][SCSI_CLASSES];
+static unsigned char lat_samples[7][SCSI_CLASSES];
+
+/* IDs that have not been told about the last bus reset, bitmask */
+static unsigned char resets;
+static Boolean recovering;
+
+static long scsi_request_sense(short scsi_id, long *sense);
+static long scsi_sense_fail(long sense, long fail);
+static void scsi_recover(short scsi_id);
+static long scsi_t_wait(short scsi_id, char *op, short op_len, short mode,
+		SCSIInstr *instr, long data_len, long timeout);
 
 /**
  * Fills a SCSIInstr for transmitting or receiving data.
@@ -131,21 +164,139 @@ static void scsi_instr(SCSIInstr *instr, long data, long data_len, short data_bl
 	instr[idx].scParam2 = 0;
 }
 
+/**
+ * Picks the latency tracking class for a command, see scsi_timeout().
+ *
+ * @param op  the CDB operation code.
+ * @return    one of the SCSI_CLASS_* values.
+ */
+static short scsi_class(unsigned char op)
+{
+	switch (op) {
+	case 0xD1:
+		return SCSI_CLASS_READ;
+	case 0xD4:
+		return SCSI_CLASS_WRITE;
+	case 0xD3:
+	case 0xD5:
+	case 0xD8:
+		return SCSI_CLASS_CONTROL;
+	default:
+		return SCSI_CLASS_QUERY;
+	}
+}
+
+/**
+ * Provides the SCSIComplete timeout for a command, in ticks.
+ *
+ * Rather than use one value for everything, the time each SCSI ID takes to run
+ * each class of command is tracked as it is observed, in the same smoothed mean and
+ * deviation style TCP uses for retransmit timers. Samples cover the whole command,
+ * from selection through the data phase to completion, and are normalized to 4K of
+ * data so a 64K read is given proportionally longer than a 4K one. The blind data
+ * phase cannot be timed out, but a target that takes much longer than this to send
+ * its status has stopped working. Until enough samples exist the old fixed
+ * SCSI_TIMEOUT is used, padded for larger transfers.
+ *
+ * @param scsi_id   device ID on [0, 6].
+ * @param cls       the command class from scsi_class().
+ * @param data_len  bytes exchanged during the command.
+ * @return          timeout to provide to SCSIComplete.
+ */
+static long scsi_timeout(short scsi_id, short cls, long data_len)
+{
+	long units, t;
+
+	units = (data_len + SCSI_UNIT_SIZE - 1) / SCSI_UNIT_SIZE;
+	if (units < 1) units = 1;
+
+	if (lat_samples[scsi_id][cls] < SCSI_SAMPLES_MIN) {
+		t = SCSI_TIMEOUT + (units - 1) * SCSI_TIMEOUT_UNIT;
+	} else {
+		t = ((long) lat_mean[scsi_id][cls] + 4L * lat_dev[scsi_id][cls]) * units / 8
+				+ SCSI_TIMEOUT_MIN;
+	}
+
+	if (t < SCSI_TIMEOUT_MIN) t = SCSI_TIMEOUT_MIN;
+	if (t > SCSI_TIMEOUT_MAX) t = SCSI_TIMEOUT_MAX;
+	return t;
+}
+
+/**
+ * Folds an observed command time into the latency tracking for a command class.
+ * Values are kept in 1/8th ticks per 4K of data.
+ *
+ * @param scsi_id   device ID on [0, 6].
+ * @param cls       the command class from scsi_class().
+ * @param data_len  bytes exchanged during the command.
+ * @param ticks     how long the command took, from selection to completion.
+ */
+static void scsi_sample(short scsi_id, short cls, long data_len, long ticks)
+{
+	long units, s, d;
+
+	units = (data_len + SCSI_UNIT_SIZE - 1) / SCSI_UNIT_SIZE;
+	if (units < 1) units = 1;
+	s = ticks * 8 / units;
+	if (s > 0x7FFF) s = 0x7FFF;
+
+	if (lat_samples[scsi_id][cls] == 0) {
+		lat_mean[scsi_id][cls] = s;
+		lat_dev[scsi_id][cls] = s / 2;
+	} else {
+		d = s - lat_mean[scsi_id][cls];
+		lat_mean[scsi_id][cls] += d / 8;
+		if (d < 0) d = -d;
+		lat_dev[scsi_id][cls] += (d - lat_dev[scsi_id][cls]) / 4;
+	}
+	if (lat_samples[scsi_id][cls] < SCSI_SAMPLES_MIN) {
+		lat_samples[scsi_id][cls]++;
+	}
+}
+
 /**
  * Low-level general handler for running a transaction against a SCSI target.
  *
- * @param scsi_id  device ID on [0, 6].
- * @param *op      pointer to CDB array to send.
- * @param op_len   length of the CDB array.
- * @param mode     <0 for read (DATA IN), >0 for write (DATA OUT), 0 for skipping the
- *                 in/out phase.
- * @param instr    address of instruction to execute; may be 0 if mode is 0.
- * @return         error code, or zero for success.
+ * If the target does not complete the command within the timeout, the bus is left
+ * in an unknown state, so this will reset it via scsi_recover() and report a 0x08
+ * failure. Other completion errors are reported as 0x05 failures without a reset.
+ *
+ * @param scsi_id   device ID on [0, 6].
+ * @param *op       pointer to CDB array to send.
+ * @param op_len    length of the CDB array.
+ * @param mode      <0 for read (DATA IN), >0 for write (DATA OUT), 0 for skipping the
+ *                  in/out phase.
+ * @param instr     address of instruction to execute; may be 0 if mode is 0.
+ * @param data_len  number of bytes the instructions exchange, for picking a timeout.
+ * @return          error code, or zero for success.
  */
-static long scsi_t(short scsi_id, char *op, short op_len, short mode, SCSIInstr *instr)
+static long scsi_t(short scsi_id, char *op, short op_len, short mode, SCSIInstr *instr,
+		long data_len)
 {
-	long fail;
-	short stat, message;
+	return scsi_t_wait(scsi_id, op, op_len, mode, instr, data_len, 0);
+}
+
+/**
+ * Same as scsi_t(), but for commands whose run time has nothing to do with how much
+ * data they exchange. A nonzero timeout is used as-is, and the time taken is not
+ * folded into the latency tracking, since it would skew the estimate for the rest
+ * of the commands in the class.
+ *
+ * @param timeout   ticks to wait for completion, or 0 to pick one adaptively.
+ * @return          error code, or zero for success.
+ */
+static long scsi_t_wait(short scsi_id, char *op, short op_len, short mode,
+		SCSIInstr *instr, long data_len, long timeout)
+{
+	long fail, start;
+	short stat, message, cls;
+	Boolean fixed;
+
+	cls = scsi_class(op[0]);
+	fixed = timeout > 0;
+	if (! fixed) {
+		timeout = scsi_timeout(scsi_id, cls, data_len);
+	}
 
 	if (fail = SCSIGet()) {
 		/* did not get bus, no cleanup required */
@@ -153,6 +304,7 @@ static long scsi_t(short scsi_id, char *op, short op_len, short mode, SCSIInstr
 		return fail;
 	}
 
+	start = TickCount();
 	if (fail = SCSISelect(scsi_id)) {
 		/* could not select, no cleanup required */
 		fail |= 0x20000;
@@ -179,11 +331,19 @@ static long scsi_t(short scsi_id, char *op, short op_len, short mode, SCSIInstr
 		}
 	}
 
-	if (fail = SCSIComplete(&stat, &message, SCSI_TIMEOUT)) {
+	if (fail = SCSIComplete(&stat, &message, timeout)) {
+		if (fail == scCommErr) {
+			/* target is hung, reset to get the bus back */
+			scsi_recover(scsi_id);
+			return 0x80000 | (fail & 0xFFFF);
+		}
 		/* completing the command failed, can't fix */
 		fail |= 0x50000;
 		return fail;
 	}
+	if (! fixed) {
+		scsi_sample(scsi_id, cls, data_len, TickCount() - start);
+	}
 
 	if (stat) {
 		/* not COMMAND COMPLETE */
@@ -195,7 +355,7 @@ static long scsi_t(short scsi_id, char *op, short op_len, short mode, SCSIInstr
 
 scsi_t_cleanup:
 	/* try to do a clean hangup */
-	SCSIComplete(&stat, &message, SCSI_TIMEOUT);
+	SCSIComplete(&stat, &message, timeout);
 	return fail;
 }
 
@@ -239,7 +399,7 @@ static long scsi_request_sense(short scsi_id, long *sense)
 	cdb[5] = 0;
 
 	scsi_instr(instr, (long) &rs, sizeof(rs), 0);
-	if (err = scsi_t(scsi_id, (char *) cdb, sizeof(cdb), SCSI_OP_READ, instr)) {
+	if (err = scsi_t(scsi_id, (char *) cdb, sizeof(cdb), SCSI_OP_READ, instr, sizeof(rs))) {
 		*sense = -1;
 		return err;
 	}
@@ -256,6 +416,132 @@ static long scsi_request_sense(short scsi_id, long *sense)
 	return 0;
 }
 
+/**
+ * Handles the cleanup after a command fails, reading the sense data so the device
+ * can clear the condition. UNIT ATTENTION is turned into a 0x09 failure since the
+ * caller needs to recover from it differently than other errors; anything else
+ * is passed through unchanged.
+ *
+ * @param scsi_id  device ID on [0, 6].
+ * @param fail     the failure code from scsi_t().
+ * @return         the failure code to report.
+ */
+static long scsi_fail(short scsi_id, long fail)
+{
+	long sense;
+
+	scsi_request_sense(scsi_id, &sense);
+	return scsi_sense_fail(sense, fail);
+}
+
+/**
+ * Converts REQUEST SENSE results per scsi_fail(), for callers that need to look
+ * at the sense data themselves.
+ *
+ * @param sense  condensed sense from scsi_request_sense().
+ * @param fail   the failure code from scsi_t().
+ * @return       the failure code to report.
+ */
+static long scsi_sense_fail(long sense, long fail)
+{
+	if (sense >= 0 && ((sense >> 16) & 0x0F) == SENSE_KEY_UNIT_ATTN) {
+		return 0x90000 | (sense & 0xFFFF);
+	} else {
+		return fail;
+	}
+}
+
+/**
+ * Runs a transaction that is safe to repeat, retrying once if the device reports
+ * UNIT ATTENTION. Used for the probing commands, which are what we use to find
+ * out about the device after a reset in the first place.
+ *
+ * Arguments are the same as scsi_t().
+ *
+ * @return  error code, or zero for success; sense data is already handled.
+ */
+static long scsi_t_probe(short scsi_id, char *op, short op_len, short mode,
+		SCSIInstr *instr, long data_len)
+{
+	long fail;
+
+	if (fail = scsi_t(scsi_id, op, op_len, mode, instr, data_len)) {
+		fail = scsi_fail(scsi_id, fail);
+		if (HiWord(fail) == 0x09) {
+			if (fail = scsi_t(scsi_id, op, op_len, mode, instr, data_len)) {
+				fail = scsi_fail(scsi_id, fail);
+			}
+		}
+	}
+	return fail;
+}
+
+/**
+ * Recovers the bus after a target stops responding partway through a command.
+ *
+ * SCSIReset is a big hammer: every device on the bus sees it, and each will then
+ * report UNIT ATTENTION on its next command. Drivers for other devices (like the
+ * boot disk) deal with that on their own. For the emulator we give it a moment to
+ * come back, then probe it with TEST UNIT READY and clear the attention condition
+ * so the next real command is not rejected. The reset is also noted for every ID
+ * so callers know cached device information (like capabilities) is stale; see
+ * scsi_take_reset().
+ *
+ * @param scsi_id  device ID on [0, 6] that stopped responding.
+ */
+static void scsi_recover(short scsi_id)
+{
+	char cdb[6];
+	long sense, final;
+	short i;
+
+	/* don't reset again if the probe below is what hung */
+	if (recovering) return;
+	recovering = true;
+
+	SCSIReset();
+	resets = 0x7F;
+	Delay(SCSI_RESET_SETTLE, &final);
+
+	/* forget timings, the device may have rebooted */
+	for (i = 0; i < SCSI_CLASSES; i++) {
+		lat_samples[scsi_id][i] = 0;
+	}
+
+	/* TEST UNIT READY; expected to fail with the post-reset attention condition */
+	for (i = 0; i < 6; i++) {
+		cdb[i] = 0;
+	}
+	if (scsi_t(scsi_id, cdb, sizeof(cdb), SCSI_OP_NO_IO, 0, 0)) {
+		scsi_request_sense(scsi_id, &sense); /* discard result */
+	}
+
+	recovering = false;
+}
+
+/**
+ * Checks if the bus was reset since this was last called for the given ID, clearing
+ * the condition. Anything remembered about the device should be fetched again when
+ * this returns true.
+ *
+ * @param scsi_id  device ID on [0, 6].
+ * @return         true if a reset happened, false otherwise.
+ */
+Boolean scsi_take_reset(short scsi_id)
+{
+	unsigned char mask;
+
+	if (scsi_id < 0 || scsi_id > 6) return false;
+	mask = 1 << scsi_id;
+
+	if (resets & mask) {
+		resets &= ~mask;
+		return true;
+	} else {
+		return false;
+	}
+}
+
 /**
  * Presents a user Alert related to a SCSI failure.
  *
@@ -266,6 +552,32 @@ void scsi_alert(long fail)
 	alert_template_error(0, ALRT_SCSI_ERROR, HiWord(fail), LoWord(fail));
 }
 
+/**
+ * Checks if a failure was due to UNIT ATTENTION. When this happens the device was
+ * likely restarted or had its memory card swapped, and the caller should consider
+ * anything it knows about the device (capabilities, file indexes) to be stale.
+ *
+ * @param fail  the failure code from another function in this unit.
+ * @return      true if this was UNIT ATTENTION, false otherwise.
+ */
+Boolean scsi_is_attention(long fail)
+{
+	return HiWord(fail) == 0x09;
+}
+
+/**
+ * Checks if a failure was because the device never finished the command, after
+ * which the bus was reset. The device may simply be slower than expected rather
+ * than broken.
+ *
+ * @param fail  the failure code from another function in this unit.
+ * @return      true if the command timed out, false otherwise.
+ */
+Boolean scsi_is_timeout(long fail)
+{
+	return HiWord(fail) == 0x08;
+}
+
 /**
  * Fetches the emulator mode page 0x31 from the device and provides the API version
  * being used.
@@ -283,7 +595,7 @@ long scsi_get_emu_api(short scsi_id, Boolean *valid, unsigned char *ver)
 {
 	SCSIInstr instr[2];
 	char cdb[6];
-	long fail, sense;
+	long fail;
 	char *data;
 
 	/* reserve enough memory for the page and both headers */
@@ -306,9 +618,8 @@ long scsi_get_emu_api(short scsi_id, Boolean *valid, unsigned char *ver)
 
 	/* check if the device can return enough data */
 	scsi_instr(instr, (long) data, 4, 0);
-	if (fail = scsi_t(scsi_id, cdb, sizeof(cdb), SCSI_OP_READ, instr)) {
-		scsi_request_sense(scsi_id, &sense); /* discard result */
-		if (fail == 0x40005 || fail >= 0x60000) {
+	if (fail = scsi_t_probe(scsi_id, cdb, sizeof(cdb), SCSI_OP_READ, instr, 4)) {
+		if (fail == 0x40005 || HiWord(fail) == 0x06) {
 			/*
 			 * Either didn't transition to DATA OUT (likely page not implemented)
 			 * or ended with CHECK CONDITION for some other reason.
@@ -324,9 +635,9 @@ long scsi_get_emu_api(short scsi_id, Boolean *valid, unsigned char *ver)
 	/* ask for that data now */
 	cdb[4] = TOOLBOX_MODE_PAGE_REQ;
 	scsi_instr(instr, (long) data, TOOLBOX_MODE_PAGE_REQ, 0);
-	if (fail = scsi_t(scsi_id, cdb, sizeof(cdb), SCSI_OP_READ, instr)) {
-		scsi_request_sense(scsi_id, &sense);
-		if (fail >= 0x60000) {
+	if (fail = scsi_t_probe(scsi_id, cdb, sizeof(cdb), SCSI_OP_READ, instr,
+			TOOLBOX_MODE_PAGE_REQ)) {
+		if (HiWord(fail) == 0x06) {
 			/* this time treat a failure to transition to DATA OUT as fatal */
 			fail = 0;
 		}
@@ -371,7 +682,7 @@ long scsi_get_emu_capabilities(short scsi_id, unsigned char *caps)
 {
 	SCSIInstr instr[2];
 	char cdb[10];
-	long fail, sense;
+	long fail;
 	char data[8];
 	short i;
 
@@ -384,8 +695,7 @@ long scsi_get_emu_capabilities(short scsi_id, unsigned char *caps)
 	cdb[8] = 8;
 
 	scsi_instr(instr, (long) data, 8, 0);
-	if (fail = scsi_t(scsi_id, cdb, sizeof(cdb), SCSI_OP_READ, instr)) {
-		scsi_request_sense(scsi_id, &sense); /* discard result */
+	if (fail = scsi_t_probe(scsi_id, cdb, sizeof(cdb), SCSI_OP_READ, instr, 8)) {
 		return fail;
 	}
 
@@ -400,37 +710,66 @@ long scsi_get_emu_capabilities(short scsi_id, unsigned char *caps)
 }
 
 /**
- * Queries a SCSI emulator and asks for a list of available items.
+ * Asks the emulator for the CRC32 of a file, computed over the whole file on the
+ * device. This is only available if the capabilities report it (responsibility of
+ * the caller).
  *
- * To list files requires 2 sequential commands:
+ * CDB is 0xD9, subcommand 2, then the file index. Byte 8 is the reply length, which
+ * is always 4: the PKZIP/zlib style CRC32 of the file, MSB first. See crc.c.
  *
- * - CDB 0xD2 for files or 0xD9 for images, remaining CDB ignored. Replies with
- *   1 byte, which is the number of files.
- * - CDB 0xD0 for files or 0xD7 for images, remaining CDB ignored. Replies with
- *   40 bytes for each file: byte 0 is index, 1 is directory yes/no, 2-34 are
- *   filename (C string), 35-39 are size (MSB) with high byte always zeroed.
+ * The device has to read the whole file to answer, so this gets its own timeout
+ * scaled by the file size rather than the adaptive one; the reply is only 4 bytes
+ * and would tell the latency tracking nothing useful. If even that runs out the
+ * 0x08 failure is returned as-is, see scsi_is_timeout().
  *
- * Handle is allocated internally, callers must use DisposHandle to clear.
+ * @param scsi_id  device ID on [0, 6].
+ * @param index    file index from the file listing.
+ * @param size     size of the file, in bytes.
+ * @param *crc     set to the CRC32 reported by the device.
+ * @return         error code, or zero for success.
+ */
+long scsi_get_file_crc(short scsi_id, short index, long size, unsigned long *crc)
+{
+	SCSIInstr instr[2];
+	char cdb[10];
+	long fail, timeout;
+	unsigned char data[4];
+
+	scsi_init_cdb(cdb);
+	cdb[0] = 0xD9;
+	cdb[1] = 2; /* get file checksum */
+	cdb[2] = index;
+	cdb[8] = 4;
+
+	timeout = SCSI_TIMEOUT + ((size >> 20) + 1) * SCSI_TIMEOUT_CRC_MB;
+	scsi_instr(instr, (long) data, 4, 0);
+	if (fail = scsi_t_wait(scsi_id, cdb, sizeof(cdb), SCSI_OP_READ, instr, 4, timeout)) {
+		/* bus was already reset on a timeout, nothing for the device to report */
+		if (scsi_is_timeout(fail)) return fail;
+		return scsi_fail(scsi_id, fail);
+	}
+
+	*crc = (unsigned long) be32(data);
+	return 0;
+}
+
+/**
+ * Asks a SCSI emulator how many items it has, without fetching the listing itself.
  *
- * Returns 0 on success. If nonzero, high byte has failure type and low byte has
- * failure code. On success the provided pointer will be set to a new Handle,
- * itself set to a chunk of memory equal to 40 bytes times the size of the
- * populated length, if and only if the length below is greater than zero.
+ * CDB is 0xD2 for files or 0xDA for images, remaining CDB ignored. Replies with
+ * 1 byte, which is the number of items.
  *
  * @param scsi_id    device ID on [0, 6].
  * @param open_type  zero for files, non-zero for images
- * @param *data      pointer that will be assigned internally to a new Handle with
- *                   data read from the device.
- * @param *length    length of data above.
+ * @param *count     set to the number of items.
  * @return           error code, or zero for success.
  */
-long scsi_list_files(short scsi_id, short open_type, Handle *data, short *length)
+long scsi_count_files(short scsi_id, short open_type, short *count)
 {
 	SCSIInstr instr[4];
 	char cdb[10];
-	Handle h;
 	unsigned char data_len;
-	long fail, sense;
+	long fail;
 
 	scsi_init_cdb(cdb);
 	if (open_type) {
@@ -440,17 +779,52 @@ long scsi_list_files(short scsi_id, short open_type, Handle *data, short *length
 	}
 
 	scsi_instr(instr, (long) &data_len, 1, 0);
-	if (fail = scsi_t(scsi_id, cdb, sizeof(cdb), SCSI_OP_READ, instr)) {
-		scsi_request_sense(scsi_id, &sense); /* discard result */
-		return fail;
+	if (fail = scsi_t(scsi_id, cdb, sizeof(cdb), SCSI_OP_READ, instr, 1)) {
+		return scsi_fail(scsi_id, fail);
 	}
 
-	*length = 40 * data_len;
+	*count = data_len;
+	return 0;
+}
+
+/**
+ * Fetches the list of available items from a SCSI emulator once the number of items
+ * is known, which must be asked for first with scsi_count_files().
+ *
+ * CDB is 0xD0 for files or 0xD7 for images, remaining CDB ignored. Replies with
+ * 40 bytes for each file: byte 0 is index, 1 is directory yes/no, 2-34 are
+ * filename (C string), 35-39 are size (MSB) with high byte always zeroed.
+ *
+ * Handle is allocated internally, callers must use DisposHandle to clear.
+ *
+ * Returns 0 on success. If nonzero, high byte has failure type and low byte has
+ * failure code. On success the provided pointer will be set to a new Handle,
+ * itself set to a chunk of memory equal to 40 bytes times the size of the
+ * populated length, if and only if the length below is greater than zero.
+ *
+ * @param scsi_id    device ID on [0, 6].
+ * @param open_type  zero for files, non-zero for images
+ * @param count      the number of items, from scsi_count_files().
+ * @param *data      pointer that will be assigned internally to a new Handle with
+ *                   data read from the device.
+ * @param *length    length of data above.
+ * @return           error code, or zero for success.
+ */
+long scsi_list_entries(short scsi_id, short open_type, short count, Handle *data,
+		short *length)
+{
+	SCSIInstr instr[4];
+	char cdb[10];
+	Handle h;
+	long fail;
+
+	*length = 40 * count;
 	if (*length <= 0) return 0;
 	if (!(h = NewHandle(*length))) {
 		mem_fail();
 	}
 
+	scsi_init_cdb(cdb);
 	if (open_type) {
 		cdb[0] = 0xD7;
 	} else {
@@ -459,12 +833,12 @@ long scsi_list_files(short scsi_id, short open_type, Handle *data, short *length
 
 	HLock(h);
 	scsi_instr(instr, (long) *h, *length, 40);
-	if (fail = scsi_t(scsi_id, cdb, sizeof(cdb), SCSI_OP_READ, instr)) {
+	if (fail = scsi_t(scsi_id, cdb, sizeof(cdb), SCSI_OP_READ, instr, *length)) {
 		/* attempt to read listing failed */
-		/* TODO probably should make it clear which call failed */
 		HUnlock(h);
 		DisposHandle(h);
-		return fail;
+		*length = 0;
+		return scsi_fail(scsi_id, fail);
 	}
 	*data = h;
 	HUnlock(h);
@@ -489,7 +863,7 @@ long scsi_read_file_bytes(short scsi_id, short index, long offset, char *data, s
 {
 	SCSIInstr instr[4];
 	char cdb[10];
-	long fail, sense;
+	long fail;
 
 	scsi_init_cdb(cdb);
 	cdb[0] = 0xD1;
@@ -500,9 +874,8 @@ long scsi_read_file_bytes(short scsi_id, short index, long offset, char *data, s
 	cdb[5] = offset & 0xFF;
 
 	scsi_instr(instr, (long) data, length, 0);
-	if (fail = scsi_t(scsi_id, cdb, sizeof(cdb), SCSI_OP_READ, instr)) {
-		scsi_request_sense(scsi_id, &sense); /* discard result */
-		return fail;
+	if (fail = scsi_t(scsi_id, cdb, sizeof(cdb), SCSI_OP_READ, instr, length)) {
+		return scsi_fail(scsi_id, fail);
 	}
 
 	return 0;
@@ -550,12 +923,12 @@ long scsi_read_file_blocks(short scsi_id, short index, long offset, char *data,
 		cdb[6] = *blocks;
 
 		scsi_instr(instr, (long) data, *blocks * 4096L, 4096);
-		if (fail = scsi_t(scsi_id, cdb, sizeof(cdb), SCSI_OP_READ, instr)) {
+		if (fail = scsi_t(scsi_id, cdb, sizeof(cdb), SCSI_OP_READ, instr, *blocks * 4096L)) {
 			scsi_request_sense(scsi_id, &sense);
 			if (sense == SENSE_INVALID_FIELD_CDB) {
 				*blocks /= 2;
 			} else {
-				return fail;
+				return scsi_sense_fail(sense, fail);
 			}
 		} else {
 			sense = 0;
@@ -578,16 +951,15 @@ long scsi_read_file_blocks(short scsi_id, short index, long offset, char *data,
 long scsi_set_image(short scsi_id, short index)
 {
 	char cdb[10];
-	long fail, sense;
+	long fail;
 	short i;
 
 	scsi_init_cdb(cdb);
 	cdb[0] = 0xD8;
 	cdb[1] = index; /* upgrade if >255 support arrives */
 
-	if (fail = scsi_t(scsi_id, cdb, sizeof(cdb), SCSI_OP_NO_IO, 0)) {
-		scsi_request_sense(scsi_id, &sense); /* discard result for now */
-		return fail;
+	if (fail = scsi_t(scsi_id, cdb, sizeof(cdb), SCSI_OP_NO_IO, 0, 0)) {
+		return scsi_fail(scsi_id, fail);
 	}
 
 	return 0;
@@ -609,15 +981,14 @@ long scsi_write_start(short scsi_id, unsigned char* name)
 {
 	SCSIInstr instr[2];
 	char cdb[10];
-	long fail, sense;
+	long fail;
 
 	scsi_init_cdb(cdb);
 	cdb[0] = 0xD3;
 
 	scsi_instr(instr, (long) name, 33, 0);
-	if (fail = scsi_t(scsi_id, cdb, sizeof(cdb), SCSI_OP_WRITE, instr)) {
-		scsi_request_sense(scsi_id, &sense); /* discard result */
-		return fail;
+	if (fail = scsi_t(scsi_id, cdb, sizeof(cdb), SCSI_OP_WRITE, instr, 33)) {
+		return scsi_fail(scsi_id, fail);
 	}
 
 	return 0;
@@ -640,7 +1011,7 @@ long scsi_write_bytes(short scsi_id, long offset, char *data, short length)
 {
 	SCSIInstr instr[2];
 	char cdb[10];
-	long fail, sense;
+	long fail;
 
 	if (length > 512) length = 512;
 
@@ -653,9 +1024,8 @@ long scsi_write_bytes(short scsi_id, long offset, char *data, short length)
 	cdb[5] = offset & 0xFF;
 
 	scsi_instr(instr, (long) data, length, 0);
-	if (fail = scsi_t(scsi_id, cdb, sizeof(cdb), SCSI_OP_WRITE, instr)) {
-		scsi_request_sense(scsi_id, &sense); /* discard result */
-		return fail;
+	if (fail = scsi_t(scsi_id, cdb, sizeof(cdb), SCSI_OP_WRITE, instr, length)) {
+		return scsi_fail(scsi_id, fail);
 	}
 
 	return 0;
@@ -699,12 +1069,12 @@ long scsi_write_blocks(short scsi_id, long offset, char *data, short *blocks)
 		cdb[6] = *blocks;
 
 		scsi_instr(instr, (long) data, *blocks * 512L, 512);
-		if (fail = scsi_t(scsi_id, cdb, sizeof(cdb), SCSI_OP_WRITE, instr)) {
+		if (fail = scsi_t(scsi_id, cdb, sizeof(cdb), SCSI_OP_WRITE, instr, *blocks * 512L)) {
 			scsi_request_sense(scsi_id, &sense);
 			if (sense == SENSE_INVALID_FIELD_CDB) {
 				*blocks /= 2;
 			} else {
-				return fail;
+				return scsi_sense_fail(sense, fail);
 			}
 		} else {
 			sense = 0;
@@ -725,15 +1095,14 @@ long scsi_write_blocks(short scsi_id, long offset, char *data, short *blocks)
 long scsi_write_end(short scsi_id)
 {
 	char cdb[10];
-	long fail, sense;
+	long fail;
 	short i;
 
 	scsi_init_cdb(cdb);
 	cdb[0] = 0xD5;
 
-	if (fail = scsi_t(scsi_id, cdb, sizeof(cdb), SCSI_OP_NO_IO, 0)) {
-		scsi_request_sense(scsi_id, &sense); /* discard result for now */
-		return fail;
+	if (fail = scsi_t(scsi_id, cdb, sizeof(cdb), SCSI_OP_NO_IO, 0, 0)) {
+		return scsi_fail(scsi_id, fail);
 	}
 
 	return 0;
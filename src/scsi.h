@@ -18,13 +18,19 @@
 #define __SCSIH__
 
 void scsi_alert(long fail);
+Boolean scsi_is_attention(long fail);
+Boolean scsi_is_timeout(long fail);
 
 long scsi_get_emu_api(short scsi_id, Boolean *valid, unsigned char *ver);
 long scsi_get_emu_capabilities(short scsi_id, unsigned char *caps);
-long scsi_list_files(short scsi_id, short open_type, Handle *data, short *length);
+long scsi_get_file_crc(short scsi_id, short index, long size, unsigned long *crc);
+long scsi_count_files(short scsi_id, short open_type, short *count);
+long scsi_list_entries(short scsi_id, short open_type, short count, Handle *data,
+		short *length);
 long scsi_read_file_bytes(short scsi_id, short index, long offset, char *data, short length);
 long scsi_read_file_blocks(short scsi_id, short index, long offset, char *data, short *blocks);
 long scsi_set_image(short scsi_id, short index);
+Boolean scsi_take_reset(short scsi_id);
 long scsi_write_start(short scsi_id, unsigned char* name);
 long scsi_write_bytes(short scsi_id, long offset, char *data, short length);
 long scsi_write_blocks(short scsi_id, long offset, char *data, short *blocks);
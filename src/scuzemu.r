@@ -1,9 +1,16 @@
 data 'MENU' (129, "File") {
-	$"0081 0000 0000 0000 0000 FFFF FFE3 0446"            /* .Å.............F */
+	$"0081 0000 0000 0000 0000 FFFF FC03 0446"            /* .Å.............F */
 	$"696C 6507 4F70 656E 2E2E 2E00 4F00 0001"            /* ile.Open....O... */
 	$"2D00 0000 0009 5570 6C6F 6164 2E2E 2E00"            /* -....ΔUpload.... */
-	$"5500 0001 2D00 0000 0004 5175 6974 0051"            /* U...-.....Quit.Q */
-	$"0000 00"                                            /* ... */
+	$"5500 0019 5570 6C6F 6164 2056 6F6C 756D"            /* U...Upload Volum */
+	$"6520 6173 2049 6D61 6765 2E2E 2E00 0000"            /* e as Image...... */
+	$"0011 446F 776E 6C6F 6164 2052 616E 6765"            /* ..Download Range */
+	$"2E2E 2E00 5200 000A 5072 6576 6965 772E"            /* ....R...Preview. */
+	$"2E2E 0050 0000 0F42 726F 7773 6520 496D"            /* ...P...Browse Im */
+	$"6167 652E 2E2E 0042 0000 154D 6F75 6E74"            /* age....B...Mount */
+	$"2049 6D61 6765 2052 6561 642D 4F6E 6C79"            /*  Image Read-Only */
+	$"0000 0000 012D 0000 0000 0451 7569 7400"            /* .....-.....Quit. */
+	$"5100 0000"                                          /* Q... */
 };
 
 data 'MENU' (130, "Edit") {
@@ -14,6 +21,18 @@ data 'MENU' (130, "Edit") {
 	$"6561 7200 0000 0000"                                /* ear..... */
 };
 
+data 'MENU' (131, "Options") {
+	$"0083 0000 0000 0000 0000 FFFF FFFF 074F"            /* .É.............O */
+	$"7074 696F 6E73 0E56 6572 6966 7920 5570"            /* ptions.Verify Up */
+	$"6C6F 6164 7300 0000 0010 4465 636F 6465"            /* loads.....Decode */
+	$"204D 6163 4269 6E61 7279 0000 0000 0D44"            /*  MacBinary....¬D */
+	$"6563 6F64 6520 4269 6E48 6578 0000 0000"            /* ecode BinHex.... */
+	$"1355 706C 6F61 6420 6173 204D 6163 4269"            /* .Upload as MacBi */
+	$"6E61 7279 0000 0000 1857 6174 6368 2044"            /* nary.....Watch D */
+	$"6576 6963 6520 666F 7220 4368 616E 6765"            /* evice for Change */
+	$"7300 0000 0000"                                     /* s..... */
+};
+
 data 'MENU' (128, "Apple") {
 	$"0080 0000 0000 0000 0000 FFFF FFFB 0114"            /* .Ä.............. */
 	$"1041 626F 7574 2073 6375 7A45 4D55 2E2E"            /* .About scuzEMU.. */
@@ -87,6 +106,74 @@ data 'DITL' (512, "Choose ID") {
 	$"8000"                                               /* Ä. */
 };
 
+data 'DITL' (513, "Upload Volume") {
+	$"000E 0000 0000 00B6 00D2 00CA 0118 0402"            /* .......∂.“. .... */
+	$"4F4B 0000 0000 00B6 0078 00CA 00BE 0406"            /* OK.....∂.x. .æ.. */
+	$"4361 6E63 656C 0000 0000 001E 0014 002E"            /* Cancel.......... */
+	$"0118 0608 566F 6C75 6D65 2031 0000 0000"            /* ....Volume 1.... */
+	$"0030 0014 0040 0118 0608 566F 6C75 6D65"            /* .0...@....Volume */
+	$"2032 0000 0000 0042 0014 0052 0118 0608"            /*  2.....B...R.... */
+	$"566F 6C75 6D65 2033 0000 0000 0054 0014"            /* Volume 3.....T.. */
+	$"0064 0118 0608 566F 6C75 6D65 2034 0000"            /* .d....Volume 4.. */
+	$"0000 0066 0014 0076 0118 0608 566F 6C75"            /* ...f...v....Volu */
+	$"6D65 2035 0000 0000 0078 0014 0088 0118"            /* me 5.....x...à.. */
+	$"0608 566F 6C75 6D65 2036 0000 0000 0094"            /* ..Volume 6.....î */
+	$"0064 00A4 0096 0602 384B 0000 0000 0094"            /* .d.§.ñ..8K.....î */
+	$"009B 00A4 00CD 0603 3136 4B00 0000 0000"            /* .õ.§.Õ..16K..... */
+	$"0094 00D2 00A4 0104 0603 3332 4B00 0000"            /* .î.“.§....32K... */
+	$"0000 0008 0014 0018 0118 881E 5365 6E64"            /* ..........à.Send */
+	$"2077 6869 6368 2076 6F6C 756D 6520 6173"            /*  which volume as */
+	$"2061 6E20 696D 6167 653F 0000 0000 0094"            /*  an image?.....î */
+	$"0014 00A4 005F 880B 426C 6F63 6B20 7369"            /* ...§._à.Block si */
+	$"7A65 3A00 0000 0000 008A 0014 008B 0118"            /* ze:......ä...ã.. */
+	$"8000 0000 0000 00B2 00CE 00CE 011C 8000"            /* Ä......≤.Œ.Œ..Ä. */
+};
+
+data 'DITL' (514, "Browse Image") {
+	$"0005 0000 0000 00E8 010E 00FC 0154 0404"            /* .............T.. */
+	$"4F70 656E 0000 0000 00E8 00BE 00FC 0104"            /* Open.......æ.... */
+	$"0404 446F 6E65 0000 0000 00E8 0014 00FC"            /* ..Done.......... */
+	$"005A 0404 4261 636B 0000 0000 0020 0014"            /* .Z..Back..... .. */
+	$"00DE 0154 8000 0000 0000 0008 0014 0018"            /* ...TÄ........... */
+	$"0154 8802 5E30 0000 0000 00E4 010A 0100"            /* .Tà.^0.......... */
+	$"0158 8000"                                          /* .XÄ. */
+};
+
+data 'DITL' (515, "Preview") {
+	$"0005 0000 0000 0104 019A 0118 01E0 0404"            /* .........ö...... */
+	$"446F 6E65 0000 0000 0105 000A 0115 0046"            /* Done...........F */
+	$"0604 5465 7874 0000 0000 0105 0050 0115"            /* ..Text.......P.. */
+	$"008C 0603 4865 7800 0000 0000 001E 000A"            /* .å..Hex......... */
+	$"00FA 01EA 8000 0000 0000 0008 000A 0018"            /* ....Ä........... */
+	$"01EA 8815 5E30 2020 2028 5E31 206F 6620"            /* ..à.^0   (^1 of  */
+	$"5E32 2062 7974 6573 2900 0000 0000 0100"            /* ^2 bytes)....... */
+	$"0196 011C 01E4 8000"                                /* .ñ....Ä. */
+};
+
+data 'DITL' (516, "Download Range") {
+	$"0008 0000 0000 00A0 010E 00B4 0154 0408"            /* .......†...¥.T.. */
+	$"446F 776E 6C6F 6164 0000 0000 00A0 00BE"            /* Download.....†.æ */
+	$"00B4 0104 0406 4361 6E63 656C 0000 0000"            /* .¥....Cancel.... */
+	$"000A 000A 002A 015E 882A 5361 7665 2070"            /* .....*.^à*Save p */
+	$"6172 7420 6F66 20D2 5E30 D32C 2077 6869"            /* art of “^0”, whi */
+	$"6368 2069 7320 5E31 2062 7974 6573 206C"            /* ch is ^1 bytes l */
+	$"6F6E 672E 0000 0000 0034 000A 0044 0046"            /* ong......4...D.F */
+	$"8806 5374 6172 743A 0000 0000 0034 0050"            /* à.Start:.....4.P */
+	$"0044 00C8 1001 3000 0000 0000 0050 000A"            /* .D.»..0......P.. */
+	$"0060 0046 8807 4C65 6E67 7468 3A00 0000"            /* .`.Fà.Length:... */
+	$"0000 0050 0050 0060 00C8 1000 0000 0000"            /* ...P.P.`.»...... */
+	$"006A 000A 009A 015E 8884 5369 7A65 7320"            /* .j...ö.^àÑSizes  */
+	$"6172 6520 696E 2062 7974 6573 2C20 6F72"            /* are in bytes, or */
+	$"2065 6E64 2069 6E20 4B20 6F72 204D 3B20"            /*  end in K or M;  */
+	$"2420 6F72 2030 7820 6769 7665 7320 6865"            /* $ or 0x gives he */
+	$"782E 2041 206E 6567 6174 6976 6520 7374"            /* x. A negative st */
+	$"6172 7420 636F 756E 7473 2062 6163 6B20"            /* art counts back  */
+	$"6672 6F6D 2074 6865 2065 6E64 2E20 416E"            /* from the end. An */
+	$"2065 6D70 7479 206C 656E 6774 6820 676F"            /*  empty length go */
+	$"6573 2074 6F20 7468 6520 656E 642E 0000"            /* es to the end... */
+	$"0000 00A0 010E 00B4 0154 8000"                      /* ...†...¥.TÄ. */
+};
+
 data 'DITL' (258, "SCSI Error") {
 	$"0001 0000 0000 0057 0124 006B 015E 0402"            /* .......W.$.k.^.. */
 	$"4F4B 0000 0000 000A 004B 004A 015E 8804"            /* OK.......K.J.^à. */
@@ -186,6 +273,24 @@ data 'DITL' (134, "Unrecognized Emulator") {
 	$"616E 7977 6179 3F00"                                /* anyway?. */
 };
 
+data 'DITL' (135, "Not Enough Space") {
+	$"0003 0000 0000 0057 0124 006B 0160 0406"            /* .......W.$.k.`.. */
+	$"4361 6E63 656C 0000 0000 0057 00B0 006B"            /* Cancel.....W.∞.k */
+	$"011A 040D 4C61 7267 6573 7420 4669 7273"            /* ...¬Largest Firs */
+	$"7400 0000 0000 0057 0046 006B 00A6 040A"            /* t......W.F.k.¶.. */
+	$"4C69 7374 204F 7264 6572 0000 0000 000A"            /* List Order...... */
+	$"0046 004A 0160 8898 5468 6520 7365 6C65"            /* .F.J.`àòThe sele */
+	$"6374 6564 2066 696C 6573 206E 6565 6420"            /* cted files need  */
+	$"5E30 4B2C 2062 7574 206F 6E6C 7920 5E31"            /* ^0K, but only ^1 */
+	$"4B20 6973 2066 7265 6520 6174 2074 6865"            /* K is free at the */
+	$"2064 6573 7469 6E61 7469 6F6E 2E20 446F"            /*  destination. Do */
+	$"776E 6C6F 6164 206F 6E6C 7920 7468 6520"            /* wnload only the  */
+	$"6669 6C65 7320 7468 6174 2066 6974 2C20"            /* files that fit,  */
+	$"7461 6B69 6E67 2074 6865 206C 6172 6765"            /* taking the large */
+	$"7374 2066 6972 7374 206F 7220 676F 696E"            /* st first or goin */
+	$"6720 696E 206C 6973 7420 6F72 6465 723F"            /* g in list order? */
+};
+
 data 'ALRT' (128, "About") {
 	$"0030 0020 00F2 016E 0080 4444"                      /* .0. ...n.ÄDD */
 };
@@ -234,6 +339,10 @@ data 'ALRT' (134, "Unrecognized Emulator") {
 	$"0028 0028 008D 0168 0086 5555"                      /* .(.(.ç.h.ÜUU */
 };
 
+data 'ALRT' (135, "Not Enough Space") {
+	$"0028 0028 009D 0192 0087 5555"                      /* .(.(.ù.í.áUU */
+};
+
 data 'ICON' (128) {
 	$"003F FC00 00C0 0300 0330 10C0 0466 6220"            /* .?...¿...0.¿.fb  */
 	$"0ADC CC10 1293 B808 22BF 6004 23E4 E004"            /* ..Ã..ì∏."ø`.#... */
@@ -284,6 +393,29 @@ data 'DLOG' (512, "Choose ID") {
 	$"6174 6F72 2049 44"                                  /* ator ID */
 };
 
+data 'DLOG' (513, "Upload Volume") {
+	$"0028 0014 00FC 0140 0001 0000 0000 0000"            /* .(.....@........ */
+	$"0000 0201 1655 706C 6F61 6420 566F 6C75"            /* .....Upload Volu */
+	$"6D65 2061 7320 496D 6167 65"                        /* me as Image */
+};
+
+data 'DLOG' (514, "Browse Image") {
+	$"0028 0028 012E 0190 0001 0000 0000 0000"            /* .(.(...ê........ */
+	$"0000 0202 0C42 726F 7773 6520 496D 6167"            /* .....Browse Imag */
+	$"65"                                                 /* e */
+};
+
+data 'DLOG' (515, "Preview") {
+	$"0028 0006 014A 01FA 0001 0000 0000 0000"            /* .(...J.......... */
+	$"0000 0203 0750 7265 7669 6577"                      /* .....Preview */
+};
+
+data 'DLOG' (516, "Download Range") {
+	$"003C 0050 00FA 01B8 0001 0000 0000 0000"            /* .<.P...∏........ */
+	$"0000 0204 0E44 6F77 6E6C 6F61 6420 5261"            /* .....Download Ra */
+	$"6E67 65"                                            /* nge */
+};
+
 data 'WIND' (128, "Main") {
 	$"0032 0010 0120 0114 0008 0000 0100 0000"            /* .2... .......... */
 	$"0000 0773 6375 7A45 4D55"                           /* ...scuzEMU */
@@ -295,7 +427,7 @@ data 'WIND' (129, "Progress") {
 };
 
 data 'STR#' (258, "SCSI Errors") {
-	$"0007 4743 6F75 6C64 206E 6F74 2067 6574"            /* ..GCould not get */
+	$"0009 4743 6F75 6C64 206E 6F74 2067 6574"            /* .ΔGCould not get */
 	$"2063 6F6E 7472 6F6C 206F 6620 7468 6520"            /*  control of the  */
 	$"5343 5349 2062 7573 2E20 4973 2061 6E6F"            /* SCSI bus. Is ano */
 	$"7468 6572 2061 7070 6C69 6361 7469 6F6E"            /* ther application */
@@ -336,7 +468,24 @@ data 'STR#' (258, "SCSI Errors") {
 	$"6561 7365 2074 6865 2061 6D6F 756E 7420"            /* ease the amount  */
 	$"6F66 2052 414D 2079 6F75 2068 6176 6520"            /* of RAM you have  */
 	$"6173 7369 676E 6564 2074 6F20 7468 6973"            /* assigned to this */
-	$"2061 7070 6C69 6361 7469 6F6E 2E"                   /*  application. */
+	$"2061 7070 6C69 6361 7469 6F6E 2E8C 5468"            /*  application.åTh */
+	$"6520 6465 7669 6365 2073 746F 7070 6564"            /* e device stopped */
+	$"2072 6573 706F 6E64 696E 672C 2073 6F20"            /*  responding, so  */
+	$"7468 6520 5343 5349 2062 7573 2077 6173"            /* the SCSI bus was */
+	$"2072 6573 6574 2E20 5472 7920 7468 6520"            /*  reset. Try the  */
+	$"6F70 6572 6174 696F 6E20 6167 6169 6E2E"            /* operation again. */
+	$"2049 6620 7468 6973 206B 6565 7073 2068"            /*  If this keeps h */
+	$"6170 7065 6E69 6E67 2063 6865 636B 2074"            /* appening check t */
+	$"6865 2064 6576 6963 6520 616E 6420 6974"            /* he device and it */
+	$"7320 6361 626C 696E 672E 8454 6865 2064"            /* s cabling.ÑThe d */
+	$"6576 6963 6520 7761 7320 7265 7365 7420"            /* evice was reset  */
+	$"6F72 2069 7473 206D 656D 6F72 7920 6361"            /* or its memory ca */
+	$"7264 2077 6173 2063 6861 6E67 6564 2C20"            /* rd was changed,  */
+	$"616E 6420 6974 2063 6F75 6C64 206E 6F74"            /* and it could not */
+	$"2062 6520 7265 636F 6E6E 6563 7465 6420"            /*  be reconnected  */
+	$"6175 746F 6D61 7469 6361 6C6C 792E 204F"            /* automatically. O */
+	$"7065 6E20 7468 6520 6465 7669 6365 2061"            /* pen the device a */
+	$"6761 696E 2061 6E64 2072 6574 7279 2E"              /* gain and retry. */
 };
 
 data 'STR#' (259, "File Errors") {
@@ -404,7 +553,7 @@ data 'STR#' (259, "File Errors") {
 };
 
 data 'STR#' (128, "Window") {
-	$"0009 2A53 656C 6563 7420 6669 6C65 2873"            /* .Δ*Select file(s */
+	$"000B 2A53 656C 6563 7420 6669 6C65 2873"            /* ..*Select file(s */
 	$"2920 2620 646F 7562 6C65 2D63 6C69 636B"            /* ) & double-click */
 	$"2074 6F20 646F 776E 6C6F 6164 2E1F 446F"            /*  to download..Do */
 	$"7562 6C65 2D63 6C69 636B 2061 6E20 696D"            /* uble-click an im */
@@ -416,10 +565,13 @@ data 'STR#' (128, "Window") {
 	$"6F61 643A 0546 696C 653A 0C44 6576 6963"            /* oad:.File:.Devic */
 	$"653A 2049 4420 580B 4D6F 6465 3A20 4669"            /* e: ID X.Mode: Fi */
 	$"6C65 730C 4D6F 6465 3A20 496D 6167 6573"            /* les.Mode: Images */
+	$"0F43 5243 3332 2043 6865 636B 7375 6D73"            /* .CRC32 Checksums */
+	$"1045 7874 7261 6374 2066 696C 6520 6173"            /* .Extract file as */
+	$"3A"                                                 /* : */
 };
 
 data 'STR#' (256, "Generic Alerts") {
-	$"0009 204E 6F20 6669 6C65 206D 6174 6368"            /* .Δ No file match */
+	$"0016 204E 6F20 6669 6C65 206D 6174 6368"            /* .. No file match */
 	$"6564 2074 6865 2067 6976 656E 2069 6E64"            /* ed the given ind */
 	$"6578 2E35 436F 756C 6420 6E6F 7420 6669"            /* ex.5Could not fi */
 	$"6E64 2073 656C 6563 7465 6420 696D 6167"            /* nd selected imag */
@@ -472,7 +624,71 @@ data 'STR#' (256, "Generic Alerts") {
 	$"7420 6265 2073 746F 7265 6420 6F6E 2074"            /* t be stored on t */
 	$"6865 2064 6576 6963 652E 2052 656E 616D"            /* he device. Renam */
 	$"6520 6974 2061 6E64 2074 7279 2061 6761"            /* e it and try aga */
-	$"696E 2E"                                            /* in. */
+	$"696E 2E48 5468 6520 6669 6C65 2064 6F65"            /* in.HThe file doe */
+	$"7320 6E6F 7420 6D61 7463 6820 7468 6520"            /* s not match the  */
+	$"636F 7079 206F 6E20 7468 6520 6465 7669"            /* copy on the devi */
+	$"6365 2061 6E64 2069 7320 7072 6F62 6162"            /* ce and is probab */
+	$"6C79 2064 616D 6167 6564 3A20 7154 6865"            /* ly damaged: qThe */
+	$"2066 696C 6520 6F6E 2074 6865 2064 6576"            /*  file on the dev */
+	$"6963 6520 646F 6573 206E 6F74 206D 6174"            /* ice does not mat */
+	$"6368 2074 6865 206F 6E65 2075 706C 6F61"            /* ch the one uploa */
+	$"6465 642E 2043 6865 636B 2074 6865 206D"            /* ded. Check the m */
+	$"656D 6F72 7920 6361 7264 2061 6E64 2063"            /* emory card and c */
+	$"6162 6C69 6E67 2C20 7468 656E 2075 706C"            /* abling, then upl */
+	$"6F61 6420 6974 2061 6761 696E 3A20 3D43"            /* oad it again: =C */
+	$"6F75 6C64 206E 6F74 2066 696E 6420 7468"            /* ould not find th */
+	$"6520 7570 6C6F 6164 6564 2066 696C 6520"            /* e uploaded file  */
+	$"6F6E 2074 6865 2064 6576 6963 6520 746F"            /* on the device to */
+	$"2076 6572 6966 7920 6974 3A20 7154 6865"            /*  verify it: qThe */
+	$"2066 696C 6520 636F 756C 6420 6E6F 7420"            /*  file could not  */
+	$"6265 2064 6563 6F64 6564 2C20 6974 206D"            /* be decoded, it m */
+	$"6179 2062 6520 6461 6D61 6765 642E 2054"            /* ay be damaged. T */
+	$"7572 6E20 6F66 6620 6465 636F 6469 6E67"            /* urn off decoding */
+	$"2069 6E20 7468 6520 4F70 7469 6F6E 7320"            /*  in the Options  */
+	$"6D65 6E75 2074 6F20 646F 776E 6C6F 6164"            /* menu to download */
+	$"2069 7420 6173 2069 7420 6973 3A20 3354"            /*  it as it is: 3T */
+	$"6865 2076 6F6C 756D 6520 6973 2074 6F6F"            /* he volume is too */
+	$"206C 6172 6765 2074 6F20 6265 2073 656E"            /*  large to be sen */
+	$"7420 6173 2061 2064 6973 6B20 696D 6167"            /* t as a disk imag */
+	$"652E BE54 6865 2066 696C 6520 6973 206E"            /* e.æThe file is n */
+	$"6F74 2061 2064 6973 6B20 696D 6167 6520"            /* ot a disk image  */
+	$"6F72 2061 7263 6869 7665 2074 6861 7420"            /* or archive that  */
+	$"6361 6E20 6265 2062 726F 7773 6564 2E20"            /* can be browsed.  */
+	$"4846 5320 766F 6C75 6D65 732C 206F 6E20"            /* HFS volumes, on  */
+	$"7468 6569 7220 6F77 6E2C 2069 6E20 6120"            /* their own, in a  */
+	$"7061 7274 6974 696F 6E65 6420 6469 736B"            /* partitioned disk */
+	$"2C20 6F72 2069 6E20 6120 4469 736B 2043"            /* , or in a Disk C */
+	$"6F70 7920 342E 3220 696D 6167 652C 2049"            /* opy 4.2 image, I */
+	$"534F 2039 3636 3020 4344 2069 6D61 6765"            /* SO 9660 CD image */
+	$"7320 616E 6420 5A49 5020 6172 6368 6976"            /* s and ZIP archiv */
+	$"6573 2061 7265 2073 7570 706F 7274 6564"            /* es are supported */
+	$"2E3B 5468 6520 6469 736B 2069 6D61 6765"            /* .;The disk image */
+	$"2061 7070 6561 7273 2074 6F20 6265 2064"            /*  appears to be d */
+	$"616D 6167 6564 2061 6E64 2063 6F75 6C64"            /* amaged and could */
+	$"206E 6F74 2062 6520 7265 6164 2E47 5468"            /*  not be read.GTh */
+	$"6520 6669 6C65 2069 7320 636F 6D70 7265"            /* e file is compre */
+	$"7373 6564 206F 7220 656E 6372 7970 7465"            /* ssed or encrypte */
+	$"6420 696E 2061 2077 6179 2074 6861 7420"            /* d in a way that  */
+	$"6361 6E6E 6F74 2062 6520 6578 7472 6163"            /* cannot be extrac */
+	$"7465 643A 2024 4F6E 6C79 2048 4653 2064"            /* ted: $Only HFS d */
+	$"6973 6B20 696D 6167 6573 2063 616E 2062"            /* isk images can b */
+	$"6520 6D6F 756E 7465 642E 4F41 6E20 696D"            /* e mounted.OAn im */
+	$"6167 6520 6973 2061 6C72 6561 6479 206D"            /* age is already m */
+	$"6F75 6E74 6564 2E20 5075 7420 6974 2061"            /* ounted. Put it a */
+	$"7761 7920 696E 2074 6865 2046 696E 6465"            /* way in the Finde */
+	$"7220 6265 666F 7265 206D 6F75 6E74 696E"            /* r before mountin */
+	$"6720 616E 6F74 6865 722E 1F54 6865 2069"            /* g another..The i */
+	$"6D61 6765 2063 6F75 6C64 206E 6F74 2062"            /* mage could not b */
+	$"6520 6D6F 756E 7465 642E 4B54 6865 2072"            /* e mounted.KThe r */
+	$"616E 6765 2069 7320 6E6F 7420 7769 7468"            /* ange is not with */
+	$"696E 2074 6865 2066 696C 652E 2043 6865"            /* in the file. Che */
+	$"636B 2074 6865 2073 7461 7274 2061 6E64"            /* ck the start and */
+	$"206C 656E 6774 6820 616E 6420 7472 7920"            /*  length and try  */
+	$"6167 6169 6E2E 3E54 6865 7265 2061 7265"            /* again.>There are */
+	$"206E 6F20 6D6F 756E 7465 6420 766F 6C75"            /*  no mounted volu */
+	$"6D65 7320 7468 6174 2063 616E 2062 6520"            /* mes that can be  */
+	$"7365 6E74 2061 7320 6120 6469 736B 2069"            /* sent as a disk i */
+	$"6D61 6765 2E"                                       /* mage. */
 };
 
 data 'ICN#' (128) {
@@ -14,9 +14,16 @@
  * program. If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include "binhex.h"
+#include "adouble.h"
 #include "config.h"
 #include "constants.h"
+#include "crc.h"
 #include "emu.h"
+#include "fork.h"
+#include "macbin.h"
+#include "names.h"
+#include "prefetch.h"
 #include "progress.h"
 #include "scsi.h"
 #include "transfer.h"
@@ -31,23 +38,48 @@
 #define XFER_BLK_SIZE  4096L
 #define XFER_BUF_SIZE  (XFER_MAX_BLOCKS * XFER_BLK_SIZE)
 
+/* how often, in ticks, to flush the volume during a long transaction */
+#define XFER_FLUSH_TICKS  1800
+
+/* how many times a transaction may reconnect after UNIT ATTENTION */
+#define XFER_MAX_RECOVER  3
+
+/* how the device file is turned into a local file */
+#define FMODE_RAW     0
+#define FMODE_MACBIN  1
+#define FMODE_BINHEX  2
+#define FMODE_DOUBLE  3 /* AppleDouble sidecar of a file already written */
+
 /* persist across a full transaction */
 static short scsi_id;
 static Handle data;
 static short *items_ptr;
-static short items_cur, items_count, vref;
+static short items_cur, items_count, vref, recoveries;
 static Boolean session, repl_dup;
-static long tstart, tend;
+static long tstart, tend, tflush;
+
+/* checksum manifest, for devices that cannot report checksums themselves */
+static short mref;
+static Boolean mopen, mfail;
 
 /* transaction remaining, for progress tracking; in file blocks */
 static long tblks, tprog;
 
+/* part of the device file to save instead of all of it, see transfer_start_range() */
+static Boolean range_on;
+static long range_off, range_len;
+static Str63 range_name;
+
 /* updated per file */
-static Boolean fopen;
-static short fref, findex;
-static long fsize, fblk, frem;
+static Boolean factive, fsmall, fside;
+static short findex, fmode;
+static long fsize, fbase, fblk, frem;
 static Str63 fname;
-static long ftype, fcreator;
+static unsigned long fcrc;
+
+/* local file being written, see transfer_write() */
+static ForkInfo finfo;
+static long fpos, dstart, rstart;
 
 /**
  * Shows an appropriate alert when a file error occurs.
@@ -75,6 +107,9 @@ static void transfer_alert_ferr(short err)
  * - If no, then this will prune out entries with duplicate file names
  *   and not execute a transfer on those files.
  *
+ * The directory is read once into a name index rather than asking the File
+ * Manager about each selected item, and pruning is done in a single pass.
+ *
  * This needs items_ptr, items_count, and vref set. repl_dup is
  * updated by this call.
  *
@@ -82,157 +117,654 @@ static void transfer_alert_ferr(short err)
  */
 static short transfer_check_duplicates(void)
 {
-	short i, err;
-	unsigned char *fn;
-	FInfo fi;
-	Boolean user_asked;
+	short i, j, err;
+	Str63 fn;
+	NameIndex *idx;
 
 	repl_dup = false;
-	user_asked = false;
 
-	if (! (fn = (unsigned char *) NewPtr(64))) {
-		mem_fail();
+	idx = names_new();
+	if (err = names_load_dir(idx, vref)) {
+		names_dispose(idx);
+		return err;
 	}
 
-	i = 0;
-	while (i < items_count) {
-
-		/* fetch expected user item */
+	/* see if there are any duplicates at all */
+	for (i = 0; i < items_count; i++) {
 		window_get_item_name(items_ptr[i], fn);
+		if (names_find(idx, fn) >= 0) break;
+	}
+
+	if (i < items_count) {
+		repl_dup = CautionAlert(ALRT_DUPLICATES, 0) == 2;
 
-		if (err = GetFInfo(fn, vref, &fi)) {
-			if (err == fnfErr) {
-				/* expected, file does not exist, move to next */
-				i++;
-			} else {
-				/* a real error, bail out */
-				DisposPtr((Ptr) fn);
-				return err;
+		/*
+		 * If the user indicated they want to replace duplicates,
+		 * all is fine, we'll let that happen during the file creation
+		 * process. If they don't want to replace we need to prune out
+		 * duplicate items in the listing.
+		 */
+		if (! repl_dup) {
+			j = i;
+			for (; i < items_count; i++) {
+				window_get_item_name(items_ptr[i], fn);
+				if (names_find(idx, fn) < 0) {
+					items_ptr[j++] = items_ptr[i];
+				}
 			}
-		} else {
-			/* no error, aka file exists; keep going to check filenames */
-			if (! user_asked) {
-				repl_dup = CautionAlert(ALRT_DUPLICATES, 0) == 2;
-				user_asked = true;
+			items_count = j;
+		}
+	}
+
+	names_dispose(idx);
+	return 0;
+}
+
+/**
+ * Checks that the selected items will fit in the free space on the destination
+ * volume, counting each file in allocation blocks as the File Manager will. When
+ * duplicates are being replaced the space held by the old copies is counted as
+ * free, since those are deleted first.
+ *
+ * If the items do not fit, the user can cancel or trim the selection down to what
+ * does fit, either taking the largest files first or going in list order. In both
+ * cases items that do not fit are skipped and the rest are still considered.
+ *
+ * This needs items_ptr, items_count, vref, and repl_dup set. items_count may be
+ * reduced by this call.
+ *
+ * @param proceed  set to true if the transfer should continue, false otherwise.
+ * @return         non-zero if an osErr was raised during the process.
+ */
+static short transfer_check_space(Boolean *proceed)
+{
+	HParamBlockRec vpb;
+	ParamBlockRec fpb;
+	Str63 fn;
+	Str15 ns, fs;
+	long *blks;
+	short *order;
+	long alblk, avail, need, size;
+	short i, j, t, err, index;
+
+	*proceed = false;
+
+	vpb.volumeParam.ioCompletion = 0;
+	vpb.volumeParam.ioNamePtr = 0;
+	vpb.volumeParam.ioVRefNum = vref;
+	vpb.volumeParam.ioVolIndex = 0;
+	if (err = PBHGetVInfo(&vpb, false)) {
+		return err;
+	}
+	alblk = vpb.volumeParam.ioVAlBlkSiz;
+	avail = (unsigned short) vpb.volumeParam.ioVFrBlk;
+
+	if (! (blks = (long *) NewPtr(items_count * sizeof(long)))) {
+		mem_fail();
+	}
+
+	/* find what each item needs, and what the whole selection needs */
+	need = 0;
+	for (i = 0; i < items_count; i++) {
+		if (!emu_get_info(items_ptr[i], &index, &size)) {
+			size = 0;
+		}
+		blks[i] = (size + alblk - 1) / alblk;
+		if (emu_get_sidecar(items_ptr[i], &index, &size)) {
+			/* nearly all of a sidecar ends up in the resource fork */
+			blks[i] += (size + alblk - 1) / alblk;
+		}
+		need += blks[i];
+
+		if (repl_dup) {
+			window_get_item_name(items_ptr[i], fn);
+			fpb.fileParam.ioCompletion = 0;
+			fpb.fileParam.ioNamePtr = fn;
+			fpb.fileParam.ioVRefNum = vref;
+			fpb.fileParam.ioFVersNum = 0;
+			fpb.fileParam.ioFDirIndex = 0;
+			if (! PBGetFInfo(&fpb, false)) {
+				avail += (fpb.fileParam.ioFlPyLen + fpb.fileParam.ioFlRPyLen) / alblk;
 			}
+		}
+	}
+
+	if (need <= avail) {
+		DisposPtr((Ptr) blks);
+		*proceed = true;
+		return 0;
+	}
 
-			/*
-			 * If the user indicated they want to replace duplicates,
-			 * all is fine, we'll let that happen during the file creation
-			 * process. If they don't want to replace we need to prune out
-			 * duplicate items in the listing.
-			 */
-			if (repl_dup) {
-				i++;
-			} else {
-				arr_del_short(items_ptr, items_count, i);
-				items_count--;
+	/* not enough room, see what the user wants to do about it */
+	NumToString((need * (alblk / 512) + 1) / 2, ns);
+	NumToString((avail * (alblk / 512) + 1) / 2, fs);
+	ParamText(ns, fs, 0, 0);
+	t = CautionAlert(ALRT_NO_SPACE, 0);
+	if (t != 2 && t != 3) {
+		DisposPtr((Ptr) blks);
+		return 0;
+	}
+
+	/* decide the order items are considered in */
+	if (! (order = (short *) NewPtr(items_count * 2))) {
+		mem_fail();
+	}
+	for (i = 0; i < items_count; i++) {
+		order[i] = i;
+	}
+	if (t == 2) {
+		/* largest first; selection is at most a few hundred items */
+		for (i = 1; i < items_count; i++) {
+			t = order[i];
+			for (j = i; j > 0 && blks[order[j - 1]] < blks[t]; j--) {
+				order[j] = order[j - 1];
 			}
+			order[j] = t;
+		}
+	}
+
+	/* keep what fits, marking the rest */
+	for (i = 0; i < items_count; i++) {
+		t = order[i];
+		if (blks[t] <= avail) {
+			avail -= blks[t];
+		} else {
+			blks[t] = -1;
+		}
+	}
+
+	/* prune marked items, keeping list order */
+	j = 0;
+	for (i = 0; i < items_count; i++) {
+		if (blks[i] >= 0) {
+			items_ptr[j++] = items_ptr[i];
 		}
 	}
+	items_count = j;
 
-	DisposPtr((Ptr) fn);
+	DisposPtr((Ptr) order);
+	DisposPtr((Ptr) blks);
+	*proceed = items_count > 0;
 	return 0;
 }
 
+/**
+ * Sets up the per-file variables for the next item to be downloaded. The local
+ * file is not created until the first data arrives, see transfer_file_open().
+ *
+ * @param item  the item number from the list to look up in emu.c.
+ * @return      true if the item was OK, false otherwise.
+ */
+static Boolean transfer_file_select(short item)
+{
+	if (!emu_get_info(item, &findex, &fsize)) {
+		alert_template(0, ALRT_GENERIC, STRI_GA_NSF);
+		return false;
+	}
+
+	window_get_item_name(item, fname);
+
+	frem = fsize;
+	fbase = 0;
+	fblk = 0;
+	fcrc = 0;
+	fside = false;
+	fsmall = (fsize <= XFER_BUF_SIZE);
+
+	if (range_on) {
+		/* start at the block holding the range, and stop at the end of it */
+		fbase = range_off / XFER_BLK_SIZE;
+		fblk = fbase;
+		frem = range_off % XFER_BLK_SIZE + range_len;
+		fsmall = false;
+	}
+
+	return true;
+}
+
+/**
+ * Sets up the current file to be saved as-is, under the name it has on the device,
+ * with a type and creator guessed from the first block of data.
+ *
+ * Unless the file is small enough to be written all at once, the whole file is
+ * preallocated when opened, see fork_create().
+ */
+static void transfer_file_raw(void)
+{
+	fmode = FMODE_RAW;
+	BlockMove(fname, finfo.name, fname[0] + 1);
+	finfo.set_info = false;
+	finfo.flags = 0;
+	finfo.crdate = 0;
+	finfo.mddate = 0;
+	finfo.dlen = (fsmall ? 0 : fsize);
+	finfo.rlen = 0;
+	if (fsize > 0) {
+		types_find(*data, fname, &(finfo.type), &(finfo.creator));
+	} else {
+		finfo.type = '????';
+		finfo.creator = '????';
+	}
+}
+
+/**
+ * Sets up a range of the current file to be saved as-is under the name the user
+ * chose, with a type and creator guessed from the start of the range. Ranges are
+ * never decoded, since they rarely start at the beginning of anything that could
+ * be.
+ */
+static void transfer_file_range(void)
+{
+	transfer_file_raw();
+	BlockMove(range_name, finfo.name, range_name[0] + 1);
+	finfo.dlen = range_len;
+	types_find(*data + range_off % XFER_BLK_SIZE, range_name,
+			&(finfo.type), &(finfo.creator));
+}
+
+/**
+ * Decides how the current file should be written out, using the first block of
+ * data. If decoding is enabled and the data is in a format that can be decoded on
+ * the fly, the decoded file is written instead of the original.
+ */
+static void transfer_file_type(void)
+{
+	if (range_on) {
+		transfer_file_range();
+		return;
+	}
+
+	transfer_file_raw();
+	if (fsize <= 0) return;
+
+	if (g_decode_macbin
+			&& macbin_parse((unsigned char *) *data, fsize, &finfo, &dstart, &rstart)) {
+		fmode = FMODE_MACBIN;
+	} else if (g_decode_binhex
+			&& binhex_head((unsigned char *) *data,
+					(fsize < XFER_BLK_SIZE ? fsize : XFER_BLK_SIZE), &finfo)) {
+		fmode = FMODE_BINHEX;
+	}
+
+	/* a decoded header may fail, but still have changed things */
+	if (fmode == FMODE_RAW) {
+		transfer_file_raw();
+	}
+}
+
 /**
  * Handles opening a transfer file for writing. This needs the volume/directory
- * reference pre-set, and will set the per-file variables upon return.
+ * reference pre-set and the file information already found from the first block
+ * of data by transfer_file_type(), so the file can be made with the right
+ * information in one call.
+ *
+ * Decoded files have their own names. Existing files are never replaced by those;
+ * if the name is taken the file is saved undecoded under its device name instead,
+ * which has already been checked by transfer_check_duplicates().
  *
  * If this fails the entire transaction should be halted.
  *
- * @param item  the item number from the list to look up in emu.c.
- * @return      true if open was OK, false otherwise.
+ * @return  true if open was OK, false otherwise.
  */
-static Boolean transfer_file_open(short item)
+static Boolean transfer_file_open(void)
 {
 	short err;
 
-	if (!emu_get_info(item, &findex, &fsize)) {
-		alert_template(0, ALRT_GENERIC, STRI_GA_NSF);
+	err = fork_create(&finfo, vref, repl_dup && fmode == FMODE_RAW);
+	if (err == dupFNErr && fmode != FMODE_RAW) {
+		transfer_file_raw();
+		err = fork_create(&finfo, vref, repl_dup);
+	}
+	if (err) {
+		transfer_alert_ferr(err);
 		return false;
 	}
 
-	window_get_item_name(item, fname);
+	fpos = fbase * XFER_BLK_SIZE;
+	return true;
+}
 
-	if (err = Create(fname, vref, '????', '????')) {
+/**
+ * Writes the part of a chunk of the device file that falls within a given range to
+ * a fork of the output file. This is used for formats where each fork is stored as
+ * one piece at a known offset.
+ *
+ * @param buf    the chunk, which starts at fpos within the device file.
+ * @param len    the length of the chunk.
+ * @param start  offset of the range within the device file.
+ * @param slen   length of the range.
+ * @param fork   the fork to write the range to.
+ * @return       zero on success, otherwise the OSErr.
+ */
+static short transfer_write_range(char *buf, long len, long start, long slen,
+		short fork)
+{
+	long a, b;
 
-		if (err == dupFNErr && repl_dup) {
+	a = (fpos > start ? fpos : start);
+	b = (fpos + len < start + slen ? fpos + len : start + slen);
+	if (a >= b) return 0;
+	return fork_write(fork, buf + (a - fpos), b - a);
+}
 
-			/* handle by deleting existing file and trying creation again */
-			if (err = FSDelete(fname, vref)) {
-				transfer_alert_ferr(err);
-				return false;
-			}
-			if (err = Create(fname, vref, '????', '????')) {
-				transfer_alert_ferr(err);
-				return false;
-			}
+/**
+ * Writes the next chunk of the device file out to the local file, decoding it as
+ * needed for the current file mode.
+ *
+ * @param buf  the chunk, which must directly follow the previous one.
+ * @param len  the length of the chunk.
+ * @return     zero on success, FORK_BAD_DATA if the file could not be decoded,
+ *             otherwise the OSErr.
+ */
+static short transfer_write(char *buf, long len)
+{
+	short err;
 
+	switch (fmode) {
+	case FMODE_MACBIN:
+		if (! (err = transfer_write_range(buf, len, dstart, finfo.dlen, FORK_DATA))) {
+			err = transfer_write_range(buf, len, rstart, finfo.rlen, FORK_RSRC);
+		}
+		break;
+	case FMODE_BINHEX:
+		err = binhex_feed((unsigned char *) buf, len);
+		break;
+	case FMODE_DOUBLE:
+		err = transfer_write_range(buf, len, rstart, finfo.rlen, FORK_RSRC);
+		break;
+	default:
+		if (range_on) {
+			err = transfer_write_range(buf, len, range_off, range_len, FORK_DATA);
 		} else {
-			/* other kind of create error */
-			transfer_alert_ferr(err);
-			return false;
+			err = fork_write(FORK_DATA, buf, len);
 		}
 	}
-	if (err = FSOpen(fname, vref, &fref)) {
-		transfer_alert_ferr(err);
+
+	fpos += len;
+	return err;
+}
+
+/**
+ * Moves on to the AppleDouble sidecar of the current file, if it has one, so that
+ * its resource fork and Finder info end up in the file just written. This is only
+ * done for files saved as-is; decoded files already have both.
+ *
+ * @return  true if the sidecar is next, false if the file is finished.
+ */
+static Boolean transfer_sidecar(void)
+{
+	short item, index;
+	long size;
+
+	if (fside || range_on || fmode != FMODE_RAW) return false;
+	if (! (emu_find(fname, &item) && emu_get_sidecar(item, &index, &size))) return false;
+
+	fside = true;
+	findex = index;
+	fsize = size;
+	frem = size;
+	fbase = 0;
+	fblk = 0;
+	fcrc = 0;
+	fpos = 0;
+	fsmall = (fsize <= XFER_BUF_SIZE);
+	fmode = FMODE_DOUBLE;
+	return true;
+}
+
+/**
+ * Reads the AppleDouble header from the first block of the sidecar. The Finder info
+ * and dates are passed on to be applied when the file is closed, and the location
+ * of the resource fork noted for transfer_write(). A sidecar that turns out not to
+ * be AppleDouble after all is read but otherwise ignored.
+ */
+static void transfer_sidecar_head(void)
+{
+	if (adouble_parse((unsigned char *) *data,
+			(fsize < XFER_BLK_SIZE ? fsize : XFER_BLK_SIZE), &finfo, &rstart)) {
+		fork_set_info(&finfo);
+	}
+}
+
+/**
+ * Gets the device name of what is currently being downloaded: the name of the
+ * current file, or of its sidecar.
+ *
+ * @param name  storage for the Pascal name, at least 64 bytes.
+ */
+static void transfer_part_name(unsigned char *name)
+{
+	short len;
+
+	len = fname[0];
+	if (fside) {
+		if (len > 61) len = 61;
+		name[0] = len + 2;
+		name[1] = '.';
+		name[2] = '_';
+		BlockMove(&(fname[1]), &(name[3]), len);
+	} else {
+		BlockMove(fname, name, len + 1);
+	}
+}
+
+/**
+ * Picks the transaction back up after the device reports UNIT ATTENTION.
+ *
+ * The listing is reloaded via emu_recover(), which means both the file index of the
+ * current download and the list items of everything still waiting are stale. All
+ * of those are located again by name; items that disappeared are dropped, and if
+ * the current file is gone or has changed size the transaction is stopped, since
+ * the card was probably swapped for a different one.
+ *
+ * @return  true if the transfer can continue, false otherwise.
+ */
+static Boolean transfer_recover(void)
+{
+	short i, t, pending;
+	long size;
+	unsigned char *names;
+
+	/* remember the names of everything not yet started */
+	pending = items_count - items_cur;
+	names = 0;
+	if (pending > 0) {
+		if (! (names = (unsigned char *) NewPtr(pending * 64L))) {
+			mem_fail();
+		}
+		for (i = 0; i < pending; i++) {
+			window_get_item_name(items_ptr[items_cur + i], &(names[i * 64]));
+		}
+	}
+
+	if (! emu_recover(scsi_id, 0)) {
+		if (names) DisposPtr((Ptr) names);
 		return false;
 	}
 
-	frem = fsize;
-	fblk = 0;
+	/* find the new location of the current file */
+	if (! (emu_find(fname, &t)
+			&& (fside ? emu_get_sidecar(t, &findex, &size) : emu_get_info(t, &findex, &size))
+			&& size == fsize)) {
+		if (names) DisposPtr((Ptr) names);
+		alert_template(0, ALRT_GENERIC, STRI_GA_NSF);
+		return false;
+	}
+
+	/* and everything after it */
+	t = items_cur;
+	for (i = 0; i < pending; i++) {
+		if (emu_find(&(names[i * 64]), &(items_ptr[t]))) {
+			t++;
+		}
+	}
+	items_count = t;
+	if (names) DisposPtr((Ptr) names);
 
 	return true;
 }
 
 /**
- * Finishes writing out the current file data and flushes the volume.
+ * Finishes writing out the current file data. The file was sized and typed when
+ * opened, so all that is left is to close it and apply any decoded Finder info.
+ *
+ * The volume is not flushed here, see transfer_flush().
  *
  * @return true if successful, false otherwise.
  */
 static Boolean transfer_file_close(void)
 {
-	FInfo info;
 	short err;
 
-	if (! fopen) return false;
+	if (! fork_is_open()) return false;
 
-	if (err = SetEOF(fref, fsize)) {
+	if (err = fork_close()) {
 		transfer_alert_ferr(err);
-		FSClose(fref); /* unconditional, just try to get out */
 		return false;
 	}
-	if (err = FSClose(fref)) {
-		transfer_alert_ferr(err);
-		return false;
+
+	return true;
+}
+
+/**
+ * Flushes the destination volume. Doing this after every file is slow when there
+ * are lots of them, so it happens on a timer during the transaction and once
+ * again at the end.
+ *
+ * @param force  if true flush now, otherwise only if the timer has run out.
+ * @return       true if successful, false otherwise.
+ */
+static Boolean transfer_flush(Boolean force)
+{
+	short err;
+
+	if (! force && TickCount() - tflush < XFER_FLUSH_TICKS) {
+		return true;
 	}
+
+	tflush = TickCount();
 	if (err = FlushVol(0, vref)) {
 		transfer_alert_ferr(err);
 		return false;
 	}
-	fopen = false;
+	return true;
+}
 
-	if (err = GetFInfo(fname, vref, &info)) {
-		transfer_alert_ferr(err);
-		return false;
+/**
+ * Initializes the transfer subsystem.
+ */
+void transfer_init(void)
+{
+	session = false;
+}
+
+/**
+ * Renders a CRC32 as 8 uppercase hex digits.
+ *
+ * @param v    the value to render.
+ * @param out  storage for the digits, not terminated.
+ */
+static void transfer_hex(unsigned long v, char *out)
+{
+	short i, d;
+
+	for (i = 7; i >= 0; i--) {
+		d = v & 0xF;
+		out[i] = (d < 10 ? '0' + d : 'A' + d - 10);
+		v >>= 4;
 	}
-	info.fdType = ftype;
-	info.fdCreator = fcreator;
-	if (err = SetFInfo(fname, vref, &info)) {
-		transfer_alert_ferr(err);
-		return false;
+}
+
+/**
+ * Records the CRC32 of the file just downloaded in a manifest file within the
+ * destination directory. Lines are "checksum  name" like most checksum tools use,
+ * so the files can be compared with the originals on another computer. The manifest
+ * is added to if it already exists.
+ *
+ * Problems with the manifest are reported once and otherwise ignored, since they do
+ * not affect the downloaded files themselves.
+ */
+static void transfer_manifest_add(void)
+{
+	Str63 mname, pname;
+	char line[80];
+	long len;
+	short err;
+
+	if (mfail) return;
+
+	if (! mopen) {
+		GetIndString(mname, STR_GENERAL, STRI_GEN_MANIFEST);
+		err = Create(mname, vref, 'ttxt', 'TEXT');
+		if (err && err != dupFNErr) goto manifest_fail;
+		if (err = FSOpen(mname, vref, &mref)) goto manifest_fail;
+		mopen = true;
+		if (err = SetFPos(mref, fsFromLEOF, 0)) goto manifest_fail;
 	}
 
+	transfer_hex(fcrc, line);
+	line[8] = ' ';
+	line[9] = ' ';
+	transfer_part_name(pname);
+	BlockMove(&(pname[1]), &(line[10]), pname[0]);
+	len = pname[0] + 10;
+	line[len++] = '\r';
+	if (err = FSWrite(mref, &len, line)) goto manifest_fail;
+	return;
+
+manifest_fail:
+	mfail = true;
+	transfer_alert_ferr(err);
+}
+
+/**
+ * Checks the CRC32 gathered while the current file was downloaded. Devices that can
+ * report their own checksums are asked for one and the user is told about any
+ * mismatch; for other devices, or if the device takes too long to answer, the
+ * checksum is put in the manifest instead.
+ *
+ * @return  false if the transfer should stop, true otherwise.
+ */
+static Boolean transfer_verify(void)
+{
+	unsigned long rcrc;
+	long err;
+	Str63 pname;
+
+	/* the checksum only covers the range, which has nothing to compare with */
+	if (range_on) return true;
+
+	if (! config_has_capability(scsi_id, CAP_CHECKSUM)) {
+		transfer_manifest_add();
+		return true;
+	}
+
+	if (err = scsi_get_file_crc(scsi_id, findex, fsize, &rcrc)) {
+		if (scsi_is_timeout(err)) {
+			/* too slow to checksum, the file itself is fine; record ours instead */
+			transfer_manifest_add();
+			return true;
+		}
+		scsi_alert(err);
+		return false;
+	}
+	if (rcrc != fcrc) {
+		transfer_part_name(pname);
+		alert_template_text(ATYPE_CAUTION, ALRT_GENERIC, STRI_GA_CRC_BAD, pname);
+	}
 	return true;
 }
 
 /**
- * Initializes the transfer subsystem.
+ * Marks the transaction as active once everything it needs is in place.
  */
-void transfer_init(void)
+static void transfer_begin(void)
 {
-	session = false;
+	session = true;
+	progress_set_percent(0);
+	progress_set_count(items_count);
+	tstart = TickCount();
+	tflush = tstart;
 }
 
 /**
@@ -259,13 +791,17 @@ Boolean transfer_start(short scsi)
 	Point p;
 	SFReply out;
 	short i, t, err;
-	Boolean dup;
+	Boolean dup, proceed;
 
 	/* TODO be noiser, this is probably a programming error */
 	if (session) return false;
 
 	scsi_id = scsi;
-	fopen = false;
+	factive = false;
+	recoveries = 0;
+	mopen = false;
+	mfail = false;
+	range_on = false;
 
 	/* scan the list and figure out how many items should be transferred */
 	items_count = 0; t = 0;
@@ -313,6 +849,15 @@ Boolean transfer_start(short scsi)
 		goto transfer_start_fail;
 	}
 
+	/* make sure it will all fit, trim if appropriate */
+	if (err = transfer_check_space(&proceed)) {
+		transfer_alert_ferr(err);
+		goto transfer_start_fail;
+	}
+	if (! proceed) {
+		goto transfer_start_fail;
+	}
+
 	/* calculate the full duration of this transfer */
 	tblks = 0;
 	tprog = 0;
@@ -322,6 +867,9 @@ Boolean transfer_start(short scsi)
 			goto transfer_start_fail;
 		}
 		tblks += fsize / XFER_BLK_SIZE + 1;
+		if (emu_get_sidecar(items_ptr[i], &t, &fsize)) {
+			tblks += fsize / XFER_BLK_SIZE + 1;
+		}
 	}
 	if (tblks < 1) tblks = 1; /* div by 0 safety */
 
@@ -329,10 +877,7 @@ Boolean transfer_start(short scsi)
 	if (!(data = NewHandle(XFER_BUF_SIZE))) {
 		mem_fail();
 	} else {
-		session = true;
-		progress_set_percent(0);
-		progress_set_count(items_count);
-		tstart = TickCount();
+		transfer_begin();
 		return true;
 	}
 
@@ -342,6 +887,67 @@ transfer_start_fail:
 	return false;
 }
 
+/**
+ * Starts a download transaction that saves only part of a single file, such as one
+ * partition out of a hard disk image. The device is still read in whole 4K blocks;
+ * the parts of the first and last blocks outside the range are dropped as the data
+ * is written. The user picks the name to save under, and the range is saved as-is
+ * without any decoding or checksum verification.
+ *
+ * Call transfer_tick() repeatedly to actually progress with the transfer, as with
+ * transfer_start().
+ *
+ * @param scsi    the SCSI ID to work with.
+ * @param item    the item number of the file in the listing.
+ * @param offset  where the range starts within the file, in bytes.
+ * @param length  the length of the range, in bytes; the range must be within the file.
+ * @return        true if the starting process went OK, false otherwise.
+ */
+Boolean transfer_start_range(short scsi, short item, long offset, long length)
+{
+	Point p;
+	SFReply out;
+	Str63 name;
+
+	if (session || offset < 0 || length <= 0) return false;
+
+	scsi_id = scsi;
+	factive = false;
+	recoveries = 0;
+	mopen = false;
+	mfail = false;
+
+	/* the Standard File package has already asked about replacing */
+	window_get_item_name(item, name);
+	SetPt(&p, 20, 20);
+	SFPutFile(p, "\pSave Range As...", name, 0, &out);
+	if (! out.good) {
+		return false;
+	}
+	vref = out.vRefNum;
+	repl_dup = true;
+	BlockMove(out.fName, range_name, out.fName[0] + 1);
+
+	if (!(items_ptr = (short *) NewPtr(2))) {
+		mem_fail();
+	}
+	items_ptr[0] = item;
+	items_cur = 0;
+	items_count = 1;
+
+	range_on = true;
+	range_off = offset;
+	range_len = length;
+	tblks = (offset % XFER_BLK_SIZE + length) / XFER_BLK_SIZE + 1;
+	tprog = 0;
+
+	if (!(data = NewHandle(XFER_BUF_SIZE))) {
+		mem_fail();
+	}
+	transfer_begin();
+	return true;
+}
+
 /**
  * Ends an ongoing transfer session.
  *
@@ -354,15 +960,17 @@ void transfer_end(void)
 {
 	if (session) {
 		session = false;
-		tend = TickCount();
 		DisposHandle(data);
 		DisposPtr((Ptr) items_ptr);
-		if (fopen) {
-			/* result of error, get rid of partial file */
-			FSClose(fref);
-			FSDelete(fname, vref);
-			fopen = false;
+		/* if a file is still open it is the result of an error, get rid of it */
+		fork_abort();
+		if (mopen) {
+			FSClose(mref);
+			mopen = false;
 		}
+		/* deferred from the individual files, see transfer_flush() */
+		transfer_flush(true);
+		tend = TickCount();
 	}
 }
 
@@ -373,16 +981,17 @@ void transfer_end(void)
  */
 Boolean transfer_tick(void)
 {
-	long err, xfer, percent;
+	long err, xfer, pre, percent;
 	short xblk;
+	char *buf;
 
 	if (! session) return false;
 
-	if (! fopen) {
+	if (! factive) {
 		/* are there more files to transfer? */
 		if (items_cur < items_count
-				&& transfer_file_open(items_ptr[items_cur++])) {
-			fopen = true;
+				&& transfer_file_select(items_ptr[items_cur++])) {
+			factive = true;
 			progress_set_file(fname);
 			progress_set_count(items_count - items_cur + 1);
 		} else {
@@ -406,40 +1015,96 @@ Boolean transfer_tick(void)
 		xfer = XFER_BLK_SIZE; /* only used if xblk = 1 */
 	}
 
-	/* perform data exchange */
+	/*
+	 * Small files are collected in the buffer and written with one call once
+	 * complete; everything else goes straight out from the start of the buffer.
+	 */
 	HLock(data);
-	if (xblk > 1) {
-		if (err = scsi_read_file_blocks(scsi_id, findex, fblk, *data, &xblk)) {
-			scsi_alert(err);
-		} else {
-			xfer = xblk * XFER_BLK_SIZE;
-			frem -= xfer;
-		}
+	buf = *data;
+	if (fsmall) {
+		buf += fblk * XFER_BLK_SIZE;
+	}
+
+	/* perform data exchange, starting from anything read ahead while idle */
+	pre = 0;
+	if (fblk == 0 && ! fside && xfer > 0) {
+		pre = prefetch_take(findex, fsize, buf,
+				(xblk > 1 ? xblk * XFER_BLK_SIZE : xfer));
+	}
+	if (pre > 0) {
+		xblk = (pre >= XFER_BLK_SIZE ? (short) (pre / XFER_BLK_SIZE) : 1);
+		xfer = pre;
+		err = 0;
+	} else if (xfer == 0) {
+		/* empty file, nothing to read */
+		err = 0;
+	} else if (xblk > 1) {
+		err = scsi_read_file_blocks(scsi_id, findex, fblk, buf, &xblk);
 	} else {
-		if (err = scsi_read_file_bytes(scsi_id, findex, fblk, *data, (short) xfer)) {
+		err = scsi_read_file_bytes(scsi_id, findex, fblk, buf, (short) xfer);
+	}
+	if (err) {
+		HUnlock(data);
+		if (scsi_is_attention(err) && recoveries++ < XFER_MAX_RECOVER) {
+			/* device reset under us; reconnect and retry this block next tick */
+			if (transfer_recover()) {
+				return true;
+			}
+		} else {
 			scsi_alert(err);
+		}
+		transfer_end();
+		return false;
+	}
+	if (xblk > 1) {
+		xfer = xblk * XFER_BLK_SIZE;
+	}
+	frem -= xfer;
+
+	/* checksum while the data is fresh, see transfer_verify() */
+	fcrc = crc32_update(fcrc, (unsigned char *) buf, xfer);
+
+	/*
+	 * Create the file with the right type, or read the sidecar header, once the
+	 * first block is in. Small files are only written once complete, so they wait
+	 * until then; the start of the file is still at the start of the buffer.
+	 */
+	if (fsmall ? frem <= 0 : fblk == fbase) {
+		if (fside) {
+			/* file already exists, just need to know what is in the sidecar */
+			transfer_sidecar_head();
 		} else {
-			frem -= xfer;
+			transfer_file_type();
+			if (! transfer_file_open()) {
+				HUnlock(data);
+				transfer_end();
+				return false;
+			}
 		}
 	}
 
-	/* write results to file if valid */
-	if (! err) {
-		if (err = FSWrite(fref, &xfer, *data)) {
-			transfer_alert_ferr(err);
+	/* write results to file when ready */
+	if (fsmall) {
+		if (frem <= 0) {
+			err = transfer_write(*data, fsize);
 		}
+	} else {
+		err = transfer_write(*data, xfer);
+	}
+	HUnlock(data);
+	if (! err && frem <= 0 && fmode == FMODE_BINHEX && ! binhex_done()) {
+		/* ran out of file before the decoder ran out of data */
+		err = FORK_BAD_DATA;
 	}
 	if (err) {
-		HUnlock(data);
+		if (err == FORK_BAD_DATA) {
+			alert_template_text(0, ALRT_GENERIC, STRI_GA_DECODE_BAD, fname);
+		} else {
+			transfer_alert_ferr(err);
+		}
 		transfer_end();
 		return false;
 	}
-
-	/* if this is the first block, try to infer a file type */
-	if (fblk == 0) {
-		types_find(*data, fname, &ftype, &fcreator);
-	}
-	HUnlock(data);
 	fblk += xblk;
 
 	tprog += xblk;
@@ -447,7 +1112,16 @@ Boolean transfer_tick(void)
 	progress_set_percent((short) percent);
 
 	if (frem <= 0) {
-		if (! transfer_file_close()) {
+		if (! transfer_verify()) {
+			transfer_end();
+			return false;
+		}
+		if (transfer_sidecar()) {
+			/* keep the file open for its resource fork and Finder info */
+			return true;
+		}
+		factive = false;
+		if (! (transfer_file_close() && transfer_flush(false))) {
 			transfer_end();
 			return false;
 		}
@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2024 saybur
+ * Copyright (C) 2024-2026 saybur
  *
  * This program is free software: you can redistribute it and/or modify it under the
  * terms of the GNU General Public License as published by the Free Software
@@ -19,6 +19,7 @@
 
 void transfer_init(void);
 Boolean transfer_start(short scsi);
+Boolean transfer_start_range(short scsi, short item, long offset, long length);
 void transfer_end(void);
 Boolean transfer_tick(void);
 long transfer_time(void);
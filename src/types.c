@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2024 saybur
+ * Copyright (C) 2024-2026 saybur
  *
  * This program is free software: you can redistribute it and/or modify it under the
  * terms of the GNU General Public License as published by the Free Software
@@ -14,15 +14,17 @@
  * program. If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include "binhex.h"
 #include "types.h"
 #include "util.h"
 
 /*
  * FIXME these probably belong in the resources instead.
  */
-#define BINHEX_MAGIC  "(This file must be converted with BinHex 4.0)"
 #define SIT_MAGIC     "rLau"
 #define SIT5_MAGIC    "Stuff"
+#define SIT5_LONG     "StuffIt (c)"
+#define ZIP_MAGIC     "PK\003\004"
 
 /**
  * Get the suffix of the given Pascal filename string as a numeric, lower-case
@@ -72,6 +74,62 @@ static long suffix_id(unsigned char *name)
 	return v;
 }
 
+/**
+ * Look for a file type and creator using only magic numbers in the first block of a
+ * file, for when the name cannot be relied on. Only formats with fairly strong magic
+ * numbers are checked. MacBinary is not handled here; use macbin_parse() for that,
+ * which also gives the type and creator of the file inside.
+ *
+ * @param data     pointer to the first data block of the file, 512 bytes at minimum.
+ * @param type     address to the long that will receive the found file type.
+ * @param creator  address to the long that will receive the found file creator.
+ * @return         true if a type was found, false otherwise.
+ */
+Boolean types_magic(char *data, long *type, long *creator)
+{
+	unsigned char *d;
+
+	d = (unsigned char *) data;
+
+	/* BinHex 4 */
+	if (str_eq(data, BINHEX_MAGIC, sizeof(BINHEX_MAGIC) - 1)) {
+		*type = 'TEXT';
+		*creator = 'SITx';
+		return true;
+	}
+
+	/* Stuffit <5 */
+	if (str_eq(data, "SIT!", 4)
+			&& str_eq(&(data[10]), SIT_MAGIC, sizeof(SIT_MAGIC) - 1)) {
+		*type = (data[15] == 0x01 ? 'SIT!' : 'SITD');
+		*creator = 'SITx';
+		return true;
+	}
+
+	/* Stuffit 5+ */
+	if (str_eq(data, SIT5_LONG, sizeof(SIT5_LONG) - 1)) {
+		*type = 'SIT5';
+		*creator = 'SITx';
+		return true;
+	}
+
+	/* Disk Copy 4.2, with a short name, a known format, and the fixed magic */
+	if (d[0] < 64 && d[80] <= 3 && d[82] == 0x01 && d[83] == 0x00) {
+		*type = 'dImg';
+		*creator = 'dCpy';
+		return true;
+	}
+
+	/* ZIP archive */
+	if (str_eq(data, ZIP_MAGIC, sizeof(ZIP_MAGIC) - 1)) {
+		*type = 'ZIP ';
+		*creator = 'SITx';
+		return true;
+	}
+
+	return false;
+}
+
 /**
  * Try to find a suitable file type and creator for a file, given the first block
  * or so of data (for magic numbers) and the filename.
@@ -152,4 +210,7 @@ void types_find(char *data, unsigned char *name, long *type, long *creator)
 		*creator = 'CPCT';
 		return;
 	}
+
+	/* no match on the name, see if the contents are recognizable anyway */
+	types_magic(data, type, creator);
 }
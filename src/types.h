@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2024 saybur
+ * Copyright (C) 2024-2026 saybur
  *
  * This program is free software: you can redistribute it and/or modify it under the
  * terms of the GNU General Public License as published by the Free Software
@@ -17,6 +17,7 @@
 #ifndef __TYPESH__
 #define __TYPESH__
 
+Boolean types_magic(char *data, long *type, long *creator);
 void types_find(char *data, unsigned char *name, long *type, long *creator);
 
 #endif /* __TYPESH__ */
@@ -16,7 +16,10 @@
 
 #include "config.h"
 #include "constants.h"
+#include "crc.h"
+#include "dialog.h"
 #include "emu.h"
+#include "macbin.h"
 #include "progress.h"
 #include "scsi.h"
 #include "upload.h"
@@ -24,13 +27,41 @@
 #include "window.h"
 
 #define UPLOAD_BLK_SIZE  512L
-#define UPLOAD_BUF_SIZE  (UPLOAD_MAX_BLOCKS * UPLOAD_BLK_SIZE)
+
+/* reads from the device during verification are in these units */
+#define UPLOAD_VFY_SIZE  4096L
+
+/* how many times an upload may restart after UNIT ATTENTION */
+#define UPLOAD_MAX_RECOVER  3
 
 static short scsi_id;
 static Handle data;
-static Boolean fopen;
-static short fref;
+static Boolean fopen, wopen;
+static short fref, recoveries;
 static long fsize, fblk, frem;
+static unsigned long fcrc;
+
+/* most blocks sent per tick, and the matching buffer size */
+static short xmax;
+static long xbuf;
+
+/* MacBinary encoding, see upload_fill(); fsize is the encoded size when active */
+static Boolean mbin;
+static short rref;
+static long spos, dlen, rlen, rstart;
+static unsigned char mhead[MACBIN_HEAD_SIZE];
+static unsigned char rname[33];
+static Str63 uname;
+
+/* volume images, read straight from the drive, see upload_volume_start() */
+static Boolean vol;
+static short vdrive, vdref;
+
+/* read back verification, see upload_verify_start() */
+static Boolean vactive, vlisted;
+static short vindex;
+static long vblk, vrem;
+static unsigned long vcrc;
 
 /**
  * Shows an appropriate alert when a file error occurs.
@@ -94,28 +125,304 @@ static Boolean upload_check_name(unsigned char *name)
  */
 static Boolean upload_check_duplicate(unsigned char *name)
 {
-	short i, cnt;
-	unsigned char *str;
+	short item;
 
-	if (! (str = (unsigned char *) NewPtr(64))) {
-		mem_fail();
+	/* case-insensitive, which at least suits FAT */
+	return emu_find(name, &item);
+}
+
+/**
+ * Zeroes part of a buffer.
+ *
+ * @param buf  the buffer.
+ * @param len  the number of bytes to zero.
+ */
+static void upload_zero(char *buf, long len)
+{
+	while (len-- > 0) {
+		*buf++ = 0;
 	}
+}
 
-	cnt = emu_get_count();
+/**
+ * Fills a buffer with the next part of what is being sent. Normally this is just
+ * the data fork of the file. When sending as MacBinary this produces the encoding as
+ * it goes: the header, the data fork, the resource fork, and the padding after each
+ * fork are read or generated as needed, so no encoded copy of the file is made.
+ * Volume images are read from the drive by block, without going through the file
+ * system at all.
+ *
+ * @param buf  the buffer to fill.
+ * @param len  the number of bytes to put in the buffer.
+ * @return     zero on success, otherwise the OSErr.
+ */
+static short upload_fill(char *buf, long len)
+{
+	ParamBlockRec pb;
+	long n;
+	short err;
+
+	if (vol) {
+		pb.ioParam.ioCompletion = 0;
+		pb.ioParam.ioVRefNum = vdrive;
+		pb.ioParam.ioRefNum = vdref;
+		pb.ioParam.ioBuffer = buf;
+		pb.ioParam.ioReqCount = len;
+		pb.ioParam.ioPosMode = fsFromStart;
+		pb.ioParam.ioPosOffset = spos;
+		if (err = PBRead(&pb, false)) return err;
+		spos += len;
+		return 0;
+	}
+	if (! mbin) {
+		if (err = FSRead(fref, &len, buf)) return err;
+		spos += len;
+		return 0;
+	}
 
-	for (i = 0; i < cnt; i++) {
-		window_get_item_name(i, str);
+	while (len > 0) {
+		if (spos < MACBIN_HEAD_SIZE) {
+			n = MACBIN_HEAD_SIZE - spos;
+			if (n > len) n = len;
+			BlockMove(&(mhead[spos]), buf, n);
+		} else if (spos < MACBIN_HEAD_SIZE + dlen) {
+			n = MACBIN_HEAD_SIZE + dlen - spos;
+			if (n > len) n = len;
+			if (err = FSRead(fref, &n, buf)) return err;
+		} else if (spos >= rstart && spos < rstart + rlen) {
+			n = rstart + rlen - spos;
+			if (n > len) n = len;
+			if (err = FSRead(rref, &n, buf)) return err;
+		} else {
+			/* padding after a fork */
+			n = (spos < rstart ? rstart : fsize) - spos;
+			if (n <= 0) return eofErr;
+			if (n > len) n = len;
+			upload_zero(buf, n);
+		}
+		buf += n;
+		len -= n;
+		spos += n;
+	}
+	return 0;
+}
 
-		/* this is a bit sloppy, but at least is case-insensitive for FAT */
-		/* a more intelligent approach might be needed in the future */
-		if (EqualString(name, str, false, false)) {
-			DisposPtr((Ptr) str);
-			return true;
+/**
+ * Moves to a position in what is being sent, see upload_fill().
+ *
+ * @param pos  the position, from the start of the file or MacBinary encoding.
+ * @return     zero on success, otherwise the OSErr.
+ */
+static short upload_seek(long pos)
+{
+	short err;
+
+	spos = pos;
+	if (vol) {
+		return 0;
+	}
+	if (! mbin) {
+		return SetFPos(fref, fsFromStart, pos);
+	}
+
+	pos = spos - MACBIN_HEAD_SIZE;
+	if (pos < 0) pos = 0;
+	if (pos > dlen) pos = dlen;
+	if (err = SetFPos(fref, fsFromStart, pos)) {
+		return err;
+	}
+
+	if (rlen > 0) {
+		pos = spos - rstart;
+		if (pos < 0) pos = 0;
+		if (pos > rlen) pos = rlen;
+		return SetFPos(rref, fsFromStart, pos);
+	}
+	return 0;
+}
+
+/**
+ * Sets up sending the chosen file as MacBinary: opens the resource fork, builds the
+ * header from the catalog information, and works out the size of the encoding.
+ *
+ * @param name  the Pascal name of the file.
+ * @param vref  the volume or working directory of the file.
+ * @return      zero on success, otherwise the OSErr.
+ */
+static short upload_macbin_open(unsigned char *name, short vref)
+{
+	ParamBlockRec pb;
+	ForkInfo info;
+	short err;
+
+	pb.fileParam.ioCompletion = 0;
+	pb.fileParam.ioNamePtr = name;
+	pb.fileParam.ioVRefNum = vref;
+	pb.fileParam.ioFVersNum = 0;
+	pb.fileParam.ioFDirIndex = 0;
+	if (err = PBGetFInfo(&pb, false)) {
+		return err;
+	}
+
+	BlockMove(name, info.name, name[0] + 1);
+	info.type = pb.fileParam.ioFlFndrInfo.fdType;
+	info.creator = pb.fileParam.ioFlFndrInfo.fdCreator;
+	info.flags = pb.fileParam.ioFlFndrInfo.fdFlags;
+	info.crdate = pb.fileParam.ioFlCrDat;
+	info.mddate = pb.fileParam.ioFlMdDat;
+	info.dlen = pb.fileParam.ioFlLgLen;
+	info.rlen = pb.fileParam.ioFlRLgLen;
+
+	/* read-only, so files that are in use can still be sent */
+	if (info.rlen > 0) {
+		pb.ioParam.ioCompletion = 0;
+		pb.ioParam.ioNamePtr = name;
+		pb.ioParam.ioVRefNum = vref;
+		pb.ioParam.ioVersNum = 0;
+		pb.ioParam.ioPermssn = fsRdPerm;
+		pb.ioParam.ioMisc = 0;
+		if (err = PBOpenRF(&pb, false)) {
+			return err;
 		}
+		rref = pb.ioParam.ioRefNum;
 	}
 
-	DisposPtr((Ptr) str);
-	return false;
+	macbin_header(mhead, &info);
+	dlen = info.dlen;
+	rlen = info.rlen;
+	rstart = MACBIN_HEAD_SIZE + ((dlen + 127) & ~127L);
+	fsize = macbin_size(&info);
+	mbin = true;
+	return 0;
+}
+
+/**
+ * Restarts the upload after the device reports UNIT ATTENTION. Whatever the device
+ * had open for the upload is gone after a reset, so the listing is refreshed, the
+ * remote file is opened again, and the data is sent over from the beginning.
+ *
+ * @return  true if the upload can continue, false otherwise.
+ */
+static Boolean upload_recover(void)
+{
+	long err;
+
+	if (! emu_recover(scsi_id, 0)) {
+		return false;
+	}
+	if (err = scsi_write_start(scsi_id, rname)) {
+		scsi_alert(err);
+		return false;
+	}
+	if (err = upload_seek(0)) {
+		upload_alert_ferr(err);
+		return false;
+	}
+
+	frem = fsize;
+	fblk = 0;
+	fcrc = 0;
+	progress_set_percent(0);
+	return true;
+}
+
+/**
+ * Starts reading the upload back from the device to check it arrived intact. The
+ * remote file is closed, then the listing is refreshed to find the index of the new
+ * file. Reading is then done by upload_verify_tick().
+ *
+ * @return  true if verification is underway, false if it could not be started, in
+ *          which case the user will have been told why.
+ */
+static Boolean upload_verify_start(void)
+{
+	long err;
+	short count, item;
+
+	wopen = false;
+	if (err = scsi_write_end(scsi_id)) {
+		scsi_alert(err);
+		return false;
+	}
+	if (err = emu_list(scsi_id, 0, &count)) {
+		scsi_alert(err);
+		return false;
+	}
+	vlisted = true;
+	if (! (emu_find(uname, &item) && emu_get_info(item, &vindex, &vrem))) {
+		alert_template_text(ATYPE_CAUTION, ALRT_GENERIC, STRI_GA_VERIFY_NSF, uname);
+		return false;
+	}
+	if (vrem != fsize) {
+		alert_template_text(ATYPE_CAUTION, ALRT_GENERIC, STRI_GA_VERIFY_BAD, uname);
+		return false;
+	}
+
+	vblk = 0;
+	vcrc = 0;
+	vactive = true;
+	progress_set_percent(0);
+	return true;
+}
+
+/**
+ * Reads the next part of the uploaded file back from the device, checksumming it
+ * without writing anything locally. Once the whole file is read the result is
+ * compared with the checksum taken while uploading.
+ *
+ * @return  true if verification should continue, false once done or on error.
+ */
+static Boolean upload_verify_tick(void)
+{
+	long err, xfer;
+	short xblk;
+
+	if (vrem <= 0) {
+		vactive = false;
+		progress_set_percent(100);
+		if (vcrc != fcrc) {
+			alert_template_text(ATYPE_CAUTION, ALRT_GENERIC, STRI_GA_VERIFY_BAD, uname);
+		}
+		return false;
+	}
+
+	/* choose size of this verify tick, in device read units */
+	if (vrem < UPLOAD_VFY_SIZE) {
+		xblk = 1;
+		xfer = vrem;
+	} else {
+		if (config_has_capability(scsi_id, CAP_LARGE_RECEIVE)) {
+			xblk = (vrem > xbuf
+					? xbuf / UPLOAD_VFY_SIZE
+					: vrem / UPLOAD_VFY_SIZE);
+		} else {
+			xblk = 1;
+		}
+		xfer = UPLOAD_VFY_SIZE; /* only used if xblk = 1 */
+	}
+
+	HLock(data);
+	if (xblk > 1) {
+		err = scsi_read_file_blocks(scsi_id, vindex, vblk, *data, &xblk);
+	} else {
+		err = scsi_read_file_bytes(scsi_id, vindex, vblk, *data, (short) xfer);
+	}
+	if (err) {
+		HUnlock(data);
+		scsi_alert(err);
+		vactive = false;
+		return false;
+	}
+	if (xblk > 1) {
+		xfer = xblk * UPLOAD_VFY_SIZE;
+	}
+	vcrc = crc32_update(vcrc, (unsigned char *) *data, xfer);
+	HUnlock(data);
+
+	vrem -= xfer;
+	vblk += xblk;
+	progress_set_percent(vblk * 100 / (fsize / UPLOAD_VFY_SIZE + 1));
+	return true;
 }
 
 /**
@@ -126,6 +433,65 @@ void upload_init(void)
 	fopen = false;
 }
 
+/**
+ * Checks the name in uname, opens the remote file, and gets everything else ready
+ * to start sending. Shared by the file and volume uploads once the source is open.
+ *
+ * @return  true if the upload can start, false otherwise.
+ */
+static Boolean upload_begin(void)
+{
+	short i;
+	long err;
+
+	frem = fsize;
+	fblk = 0;
+	fcrc = 0;
+	xbuf = xmax * UPLOAD_BLK_SIZE;
+
+	/* convert the file name to what the emulator expects */
+	if (uname[0] > 32) {
+		alert_template(0, ALRT_GENERIC, STRI_GA_UP_BADLEN);
+		return false;
+	}
+	if (! upload_check_name(uname)) {
+		alert_template(0, ALRT_GENERIC, STRI_GA_UP_BADCHAR);
+		return false;
+	}
+	if (upload_check_duplicate(uname)) {
+		if (CautionAlert(ALRT_UPLOAD_DUP, 0) == 2) {
+			/* they indicated an overwrite is OK, so be it! */
+		} else {
+			return false;
+		}
+	}
+	for (i = 0; i < sizeof(rname); i++) {
+		rname[i] = '\0';
+	}
+	BlockMove(&(uname[1]), rname, uname[0]);
+
+	/* open the file on the remote device */
+	if (err = scsi_write_start(scsi_id, rname)) {
+		scsi_alert(err);
+		return false;
+	}
+	wopen = true;
+
+	/* allocate a buffer for the operation */
+	if (! (data = NewHandle(xbuf))) {
+		mem_fail();
+	}
+
+	/* progression reporting setup */
+	progress_set_file(uname);
+	progress_set_count(1);
+	progress_set_percent(0);
+
+	/* all set up */
+	fopen = true;
+	return true;
+}
+
 /**
  * Called when a user requests an upload. This will:
  *
@@ -145,15 +511,18 @@ Boolean upload_start(short scsi)
 {
 	Point p;
 	SFReply reply;
-	unsigned char *name;
-	short i, nl;
 	long err;
-	char c;
 
 	if (fopen) return false;
 
 	scsi_id = scsi;
 	fopen = false;
+	wopen = false;
+	vactive = false;
+	vlisted = false;
+	vol = false;
+	xmax = UPLOAD_MAX_BLOCKS;
+	recoveries = 0;
 
 	/* let the user pick out the file */
 	SetPt(&p, 20, 20);
@@ -169,60 +538,131 @@ Boolean upload_start(short scsi)
 	}
 
 	/* store information about the file length */
+	mbin = false;
+	rref = 0;
+	spos = 0;
 	if (err = GetEOF(fref, &fsize)) {
 		upload_alert_ferr(err);
 		FSClose(fref);
 		return false;
 	}
-	frem = fsize;
-	fblk = 0;
-
-	/* convert the file name to what the emulator expects */
-	if (reply.fName[0] > 32) {
-		alert_template(0, ALRT_GENERIC, STRI_GA_UP_BADLEN);
+	if (g_upload_macbin && (err = upload_macbin_open(reply.fName, reply.vRefNum))) {
+		upload_alert_ferr(err);
 		goto upload_start_fail;
 	}
-	if (! upload_check_name(reply.fName)) {
-		alert_template(0, ALRT_GENERIC, STRI_GA_UP_BADCHAR);
-		goto upload_start_fail;
+
+	/* MacBinary files get the usual suffix on the device */
+	BlockMove(reply.fName, uname, reply.fName[0] + 1);
+	if (mbin && uname[0] <= 32 - 4) {
+		BlockMove(".bin", &(uname[uname[0] + 1]), 4);
+		uname[0] += 4;
+	} else if (mbin) {
+		uname[0] = 33; /* will not fit, fail below */
 	}
-	if (upload_check_duplicate(reply.fName)) {
-		if (CautionAlert(ALRT_UPLOAD_DUP, 0) == 2) {
-			/* they indicated an overwrite is OK, so be it! */
-		} else {
-			goto upload_start_fail;
-		}
+
+	if (upload_begin()) {
+		return true;
 	}
-	if (! (name = (unsigned char *) NewPtrClear(33))) {
-		mem_fail();
+
+upload_start_fail:
+	if (rref) FSClose(rref);
+	FSClose(fref);
+	return false;
+}
+
+/**
+ * Called when a user requests a mounted volume be sent as a disk image. The volume
+ * and read size are picked in a dialog, then the drive is found by walking the drive
+ * queue the same way emu_eject() does. The blocks are read through the disk driver
+ * as they are sent, so nothing is staged locally and the image is an exact copy of
+ * what the driver presents for that drive. For hard disks that is the partition the
+ * volume is on, not the whole disk, which is why the image gets the .img suffix.
+ *
+ * Files open on the volume can change while it is being read. The volume is flushed
+ * before starting, but it is best to quit other applications first.
+ *
+ * @param scsi  the SCSI ID to send the image to.
+ * @return      true if the process started OK, false otherwise.
+ */
+Boolean upload_volume_start(short scsi)
+{
+	VolumeParam pb;
+	QHdrPtr qhp;
+	DrvQEl *qep;
+	short vref, blocks, err;
+	long size;
+
+	if (fopen) return false;
+
+	scsi_id = scsi;
+	fopen = false;
+	wopen = false;
+	vactive = false;
+	vlisted = false;
+	mbin = false;
+	rref = 0;
+	spos = 0;
+	recoveries = 0;
+
+	if (! dialog_volume(&vref, &blocks)) {
+		return false;
 	}
-	BlockMove(&(reply.fName[1]), name, reply.fName[0]);
 
-	/* open the file on the remote device */
-	err = scsi_write_start(scsi_id, name);
-	DisposPtr((Ptr) name);
-	if (err) {
-		scsi_alert(err);
-		goto upload_start_fail;
+	/* find the drive and driver behind the volume */
+	pb.ioCompletion = 0;
+	pb.ioNamePtr = uname;
+	pb.ioVRefNum = vref;
+	pb.ioVolIndex = 0;
+	if (err = PBGetVInfo((ParmBlkPtr) &pb, false)) {
+		upload_alert_ferr(err);
+		return false;
+	}
+	vdrive = pb.ioVDrvInfo;
+	vdref = pb.ioVDRefNum;
+
+	/* size comes from the drive queue, the volume may not fill the drive */
+	size = 0;
+	qhp = GetDrvQHdr();
+	qep = (DrvQEl *) qhp->qHead;
+	while (qep) {
+		if (qep->dQDrive == vdrive && qep->dQRefNum == vdref) {
+			size = (unsigned short) qep->dQDrvSz;
+			if (qep->qType) {
+				size += (long) qep->dQDrvSz2 << 16;
+			}
+			break;
+		}
+		qep = (DrvQEl *) qep->qLink;
+	}
+	if (! size) {
+		alert_template(0, ALRT_GENERIC, STRI_GA_NO_DEV);
+		return false;
 	}
 
-	/* allocate a buffer for the operation */
-	if (! (data = NewHandle(UPLOAD_BUF_SIZE))) {
-		mem_fail();
+	/* the driver is addressed by byte offset, which runs out at 2GB */
+	if (size > 0x7FFFFFFFL / UPLOAD_BLK_SIZE) {
+		alert_template(0, ALRT_GENERIC, STRI_GA_VOL_BIG);
+		return false;
 	}
+	fsize = size * UPLOAD_BLK_SIZE;
 
-	/* progression reporting setup */
-	progress_set_file(reply.fName);
-	progress_set_count(1);
-	progress_set_percent(0);
+	FlushVol(0L, vref);
 
-	/* all set up */
-	fopen = true;
-	return true;
+	/* name the image after the volume */
+	if (uname[0] <= 32 - 4) {
+		BlockMove(".img", &(uname[uname[0] + 1]), 4);
+		uname[0] += 4;
+	} else {
+		uname[0] = 33; /* will not fit, fail in upload_begin() */
+	}
 
-upload_start_fail:
-	FSClose(fref);
-	return false;
+	vol = true;
+	xmax = blocks;
+	if (! upload_begin()) {
+		vol = false;
+		return false;
+	}
+	return true;
 }
 
 /**
@@ -240,17 +680,37 @@ void upload_end(void)
 	if (! fopen) return;
 
 	DisposHandle(data);
+	vactive = false;
 
 	/* close up; at this point errors can't really be resolved, just alert the user */
-	if (err = scsi_write_end(scsi_id)) {
-		scsi_alert(err);
+	if (wopen) {
+		wopen = false;
+		if (err = scsi_write_end(scsi_id)) {
+			scsi_alert(err);
+		}
 	}
-	if (err = FSClose(fref)) {
+	if (rref) {
+		FSClose(rref);
+		rref = 0;
+	}
+	if (! vol && (err = FSClose(fref))) {
 		upload_alert_ferr(err);
 	}
 	fopen = false;
 }
 
+/**
+ * Indicates whether the file listing was fetched again after the last upload was
+ * sent, as it is to find the file for verification. When it was, there is no need
+ * to fetch it once more afterwards; the cached copy is up to date.
+ *
+ * @return  true if the listing already reflects the upload, false otherwise.
+ */
+Boolean upload_listed(void)
+{
+	return vlisted;
+}
+
 /**
  * Executes upload block(s).
  *
@@ -263,13 +723,21 @@ Boolean upload_tick(void)
 
 	if (! fopen) return false;
 
+	if (vactive) {
+		if (upload_verify_tick()) {
+			return true;
+		}
+		upload_end();
+		return false;
+	}
+
 	/* choose size of this upload tick */
 	if (frem < UPLOAD_BLK_SIZE) {
 		xblk = 1;
 		xfer = frem;
 	} else {
 		if (config_has_capability(scsi_id, CAP_LARGE_SEND)) {
-			xblk = (frem > UPLOAD_BUF_SIZE ? UPLOAD_MAX_BLOCKS : frem / UPLOAD_BLK_SIZE);
+			xblk = (frem > xbuf ? xmax : frem / UPLOAD_BLK_SIZE);
 		} else {
 			xblk = 1;
 		}
@@ -278,6 +746,9 @@ Boolean upload_tick(void)
 
 	if (xfer == 0) {
 		progress_set_percent(100);
+		if (g_verify_upload && upload_verify_start()) {
+			return true;
+		}
 		upload_end();
 		return false;
 	} else {
@@ -285,28 +756,39 @@ Boolean upload_tick(void)
 
 		/* send the data block(s) */
 		HLock(data);
-		if (err = FSRead(fref, &xfer, *data)) {
+		if (err = upload_fill(*data, xfer)) {
 			upload_alert_ferr(err);
 		} else {
+			oxblk = xblk;
 			if (xblk > 1) {
-				oxblk = xblk;
-				if (err = scsi_write_blocks(scsi_id, fblk, *data, &xblk)) {
-					scsi_alert(err);
-				} else {
-					xfer = xblk * UPLOAD_BLK_SIZE;
-					frem -= xfer;
-					if (oxblk != xblk) {
-						/* mismatch between bytes read and written, rewind */
-						if (err = SetFPos(fref, fsFromLEOF, -1 * frem)) {
-							upload_alert_ferr(err);
-						}
+				err = scsi_write_blocks(scsi_id, fblk, *data, &xblk);
+			} else {
+				err = scsi_write_bytes(scsi_id, fblk, *data, (short) xfer);
+			}
+
+			if (err) {
+				if (scsi_is_attention(err) && recoveries++ < UPLOAD_MAX_RECOVER) {
+					/* device reset under us, start over */
+					HUnlock(data);
+					if (upload_recover()) {
+						return true;
+					} else {
+						upload_end();
+						return false;
 					}
 				}
+				scsi_alert(err);
 			} else {
-				if (err = scsi_write_bytes(scsi_id, fblk, *data, (short) xfer)) {
-					scsi_alert(err);
-				} else {
-					frem -= xfer;
+				if (oxblk > 1) {
+					xfer = xblk * UPLOAD_BLK_SIZE;
+				}
+				fcrc = crc32_update(fcrc, (unsigned char *) *data, xfer);
+				frem -= xfer;
+				if (oxblk != xblk) {
+					/* mismatch between bytes read and written, rewind */
+					if (err = upload_seek(fsize - frem)) {
+						upload_alert_ferr(err);
+					}
 				}
 			}
 		}
@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2024 saybur
+ * Copyright (C) 2024-2026 saybur
  *
  * This program is free software: you can redistribute it and/or modify it under the
  * terms of the GNU General Public License as published by the Free Software
@@ -19,7 +19,9 @@
 
 void upload_init(void);
 Boolean upload_start(short scsi);
+Boolean upload_volume_start(short scsi);
 void upload_end(void);
+Boolean upload_listed(void);
 Boolean upload_tick(void);
 
 #endif /* __UPLOADH__ */
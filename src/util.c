@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2024 saybur
+ * Copyright (C) 2024-2026 saybur
  *
  * This program is free software: you can redistribute it and/or modify it under the
  * terms of the GNU General Public License as published by the Free Software
@@ -110,6 +110,47 @@ void alert_template_error(short type, short res_id, short str_id, short err)
 	DisposPtr((Ptr) s);
 }
 
+/**
+ * Presents an alert using the given ALRT resource, with a message contained in a
+ * STR# resource with a matching ID, followed by some other text.
+ *
+ * This is the same as alert_template(), except that "^1" will be replaced by the
+ * given text, such as a file name.
+ *
+ * @param type    type of alert to use, 0 for default (StopAlert).
+ * @param res_id  the ALRT and STR# resources to pull from.
+ * @param str_id  the string ID within the resource to get.
+ * @param text    the Pascal string to show after the message.
+ */
+void alert_template_text(short type, short res_id, short str_id, unsigned char *text)
+{
+	unsigned char *s;
+
+	if (! (s = (unsigned char *) NewPtr(256))) {
+		mem_fail();
+	}
+
+	/* load the error message */
+	GetIndString(s, res_id, str_id);
+
+	/* show message */
+	SetCursor(&arrow);
+	ParamText(s, text, 0, 0);
+	switch (type)
+	{
+	case ATYPE_CAUTION:
+		CautionAlert(res_id, 0);
+		break;
+	case ATYPE_NOTE:
+		NoteAlert(res_id, 0);
+		break;
+	default:
+		StopAlert(res_id, 0);
+	}
+
+	DisposPtr((Ptr) s);
+}
+
 /**
  * Deletes an item from an array of shorts, shifting remaining entries.
  *
@@ -126,6 +167,31 @@ void arr_del_short(short *arr, short len, short itm)
 	}
 }
 
+/**
+ * Reads a big-endian 16-bit value, as found in Mac and most on-disk formats.
+ *
+ * @param p  the first byte.
+ * @return   the value.
+ */
+unsigned short be16(unsigned char *p)
+{
+	return ((unsigned short) p[0] << 8) + p[1];
+}
+
+/**
+ * Reads a big-endian 32-bit value.
+ *
+ * @param p  the first byte.
+ * @return   the value.
+ */
+long be32(unsigned char *p)
+{
+	return ((long) p[0] << 24)
+			+ ((long) p[1] << 16)
+			+ ((long) p[2] << 8)
+			+ (long) p[3];
+}
+
 /**
  * One-line call to change the cursor to show the stopwatch symbol.
  */
@@ -173,6 +239,21 @@ void center_window(WindowPtr window)
 	SetPort(old_port);
 }
 
+/**
+ * Flushes the processor instruction cache, for after code has been built in memory
+ * to jump into the program. Machines without _HWPriv predate the caches that would
+ * need it, so nothing is done on those.
+ */
+void flush_code(void)
+{
+	if (! trap_available(0xA198)) return;
+
+	asm {
+		moveq   #1, d0          /* FlushInstructionCache */
+		dc.w    0xA198          /* _HWPriv */
+	}
+}
+
 /**
  * Performs the usual Mac calls to start up a program and sets up the utility
  * functions for later use.
@@ -225,6 +306,31 @@ Boolean init_program(void (*quit)(void), short ptrcnt)
 	return true;
 }
 
+/**
+ * Reads a little-endian 16-bit value, as found in PC formats like ZIP.
+ *
+ * @param p  the first byte.
+ * @return   the value.
+ */
+unsigned short le16(unsigned char *p)
+{
+	return ((unsigned short) p[1] << 8) + p[0];
+}
+
+/**
+ * Reads a little-endian 32-bit value.
+ *
+ * @param p  the first byte.
+ * @return   the value.
+ */
+long le32(unsigned char *p)
+{
+	return ((long) p[3] << 24)
+			+ ((long) p[2] << 16)
+			+ ((long) p[1] << 8)
+			+ (long) p[0];
+}
+
 /**
  * tolower() equivalent. This currently supports the low ASCII characters and nothing
  * else. It would be nice at some point to expand compatibility if internationalization
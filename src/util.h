@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2024 saybur
+ * Copyright (C) 2024-2026 saybur
  *
  * This program is free software: you can redistribute it and/or modify it under the
  * terms of the GNU General Public License as published by the Free Software
@@ -33,10 +33,16 @@
 
 void alert_template(short type, short res_id, short str_id);
 void alert_template_error(short type, short res_id, short str_id, short err);
+void alert_template_text(short type, short res_id, short str_id, unsigned char *text);
 void arr_del_short(short *arr, short len, short itm);
+unsigned short be16(unsigned char *p);
+long be32(unsigned char *p);
 void busy_cursor(void);
 void center_window(WindowPtr window);
+void flush_code(void);
 Boolean init_program(void (*quit)(void), short ptrcnt);
+unsigned short le16(unsigned char *p);
+long le32(unsigned char *p);
 char lowerc(char c);
 void mem_fail(void);
 void repl_chars(unsigned char *s, char a, char b);
@@ -0,0 +1,566 @@
+/*
+ * Copyright (C) 2026 saybur
+ *
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this
+ * program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include "constants.h"
+#include "emu.h"
+#include "image.h"
+#include "scsi.h"
+#include "util.h"
+#include "vdisk.h"
+#include "window.h"
+
+/*
+ * This compilation unit mounts an HFS disk image on the device as a read-only volume
+ * without downloading it. A small block device driver is installed in the unit table
+ * with its own drive queue entry, and the blocks the File Manager asks for are read
+ * from the image with the 0xD1 file read as they are needed. Reads go through a RAM
+ * cache of 16K lines, so each miss also reads ahead the rest of its line, which
+ * covers the B-tree nodes and consecutive file blocks that tend to be read next.
+ *
+ * The driver lives in the application: its header and entry points are built in a
+ * system heap block at mount time, and each entry point loads the application A5
+ * and jumps to vdisk_glue(), which calls into the C code here. This means the image
+ * can only stay mounted while the program is running. Quitting unmounts it, and
+ * putting it away in the Finder removes the driver again. Only one image is
+ * mounted at a time.
+ *
+ * Requests are served synchronously, including asynchronous ones, as there is no
+ * way to have the device read in the background.
+ *
+ * The image is found again by name each time the file listing is reloaded, as its
+ * index may have changed. If it is gone or its size is different, the card was
+ * probably swapped, and the drive goes offline rather than read from another file.
+ */
+
+#define VDISK_NAME        "\p.scuzEMU"
+
+/* cache lines, each some number of 4K blocks from the image */
+#define VDISK_LINES       4
+#define VDISK_LINE_BLKS   4
+#define VDISK_LINE_SIZE   (VDISK_LINE_BLKS * 4096L)
+
+/* driver entry points, in header order */
+#define VDISK_OPEN        0
+#define VDISK_PRIME       1
+#define VDISK_CTL         2
+#define VDISK_STATUS      3
+#define VDISK_CLOSE       4
+
+/* driver flags: read, write (to refuse it), control and status, and open */
+#define VDISK_FLAGS       0x0F00
+#define VDISK_OPENED      0x0020
+
+/* unit table entries from here up are free for applications to use */
+#define VDISK_FIRST_UNIT  48
+
+/* drive queue element flag bytes: locked, and a non-ejectable disk in place */
+#define VDISK_LOCKED      0x80
+#define VDISK_IN_PLACE    0x08
+
+/* low memory globals */
+#define VDISK_UTABLE      (*(DCtlHandle **) 0x011C)
+#define VDISK_UNITS       (*(short *) 0x01D2)
+
+/* Control codes */
+#define VDISK_KILL_IO     1
+#define VDISK_EJECT       7
+
+/*
+ * Each entry point is MOVE.W #sel,D0; MOVE.L #a5,D1; JMP vdisk_glue.
+ */
+typedef struct {
+	short move_w;
+	short sel;
+	short move_l;
+	long a5;
+	short jmp;
+	ProcPtr addr;
+} VDiskEntry;
+
+typedef struct {
+	short flags;
+	short delay;
+	short emask;
+	short menu;
+	short offset[5];
+	unsigned char name[10];
+	VDiskEntry entry[5];
+} VDiskDriver;
+
+static Boolean mounted, ejected, gone;
+static short scsi_id, findex, unit, drive;
+static long fsize, voff;
+static Str63 fname;
+static VDiskDriver *drvr;
+static Ptr qel;
+
+static Ptr lines;
+static long lblk[VDISK_LINES];
+static unsigned long lused[VDISK_LINES], ltick;
+
+static void vdisk_glue(void);
+
+/**
+ * Installs a driver in the unit table with _DrvrInstall, which does not have glue.
+ *
+ * @param d    the driver.
+ * @param ref  the driver reference number.
+ * @return     the OSErr from the trap.
+ */
+static OSErr vdisk_drvr_install(Ptr d, short ref)
+{
+	OSErr err;
+
+	asm {
+		movea.l d, a0
+		move.w  ref, d0
+		dc.w    0xA03D        /* _DrvrInstall */
+		move.w  d0, err
+	}
+	return err;
+}
+
+/**
+ * Removes a driver from the unit table with _DrvrRemove.
+ *
+ * @param ref  the driver reference number.
+ * @return     the OSErr from the trap.
+ */
+static OSErr vdisk_drvr_remove(short ref)
+{
+	OSErr err;
+
+	asm {
+		move.w  ref, d0
+		dc.w    0xA03E        /* _DrvrRemove */
+		move.w  d0, err
+	}
+	return err;
+}
+
+/**
+ * Reads a line of blocks from the image into the cache, replacing the least
+ * recently used line if it is not already there.
+ *
+ * @param blk   a 4K block within the line.
+ * @param line  set to the start of the line in the cache.
+ * @return      zero on success, otherwise the SCSI fail code.
+ */
+static long vdisk_line(long blk, Ptr *line)
+{
+	long first, err;
+	short i, l, got;
+	Ptr dst;
+
+	first = blk - blk % VDISK_LINE_BLKS;
+	l = 0;
+	for (i = 0; i < VDISK_LINES; i++) {
+		if (lblk[i] == first) {
+			lused[i] = ++ltick;
+			*line = lines + i * VDISK_LINE_SIZE;
+			return 0;
+		}
+		if (lused[i] < lused[l]) l = i;
+	}
+
+	dst = lines + l * VDISK_LINE_SIZE;
+	lblk[l] = -1;
+	lused[l] = 0;
+	err = 0;
+	for (blk = first; blk < first + VDISK_LINE_BLKS && ! err; blk += got) {
+		if (blk * 4096L >= fsize) break;
+		if ((blk + 1) * 4096L > fsize) {
+			/* partial block at the end of the image */
+			got = 1;
+			err = scsi_read_file_bytes(scsi_id, findex, blk, dst,
+					(short) (fsize - blk * 4096L));
+		} else if (config_has_capability(scsi_id, CAP_LARGE_RECEIVE)) {
+			got = (short) (first + VDISK_LINE_BLKS - blk);
+			if ((blk + got) * 4096L > fsize) got = (short) (fsize / 4096L - blk);
+			err = scsi_read_file_blocks(scsi_id, findex, blk, dst, &got);
+		} else {
+			got = 1;
+			err = scsi_read_file_bytes(scsi_id, findex, blk, dst, 4096);
+		}
+		dst += got * 4096L;
+	}
+	if (err) return err;
+
+	lblk[l] = first;
+	lused[l] = ++ltick;
+	*line = lines + l * VDISK_LINE_SIZE;
+	return 0;
+}
+
+/**
+ * Handles a read or write request. Writes are refused, as the volume is locked.
+ */
+static OSErr vdisk_prime(IOParam *pb, DCtlPtr dce)
+{
+	long pos, len, off, n;
+	Ptr buf, line;
+
+	pb->ioActCount = 0;
+	if (gone) {
+		return offLinErr;
+	}
+	if ((pb->ioTrap & 0x00FF) != aRdCmd) {
+		return wPrErr;
+	}
+
+	pos = dce->dCtlPosition;
+	len = pb->ioReqCount;
+	if (pos < 0 || len < 0 || voff + pos + len > fsize) {
+		return paramErr;
+	}
+
+	buf = pb->ioBuffer;
+	while (len > 0) {
+		off = voff + pos;
+		if (vdisk_line(off / 4096L, &line)) {
+			return ioErr;
+		}
+		off %= VDISK_LINE_SIZE;
+		n = VDISK_LINE_SIZE - off;
+		if (n > len) n = len;
+		BlockMove(line + off, buf, n);
+		buf += n;
+		pos += n;
+		len -= n;
+		pb->ioActCount += n;
+	}
+	dce->dCtlPosition = pos;
+	return noErr;
+}
+
+/**
+ * Called from vdisk_glue() for each request to the driver, with A5 set up.
+ *
+ * @param sel  which entry point was called.
+ * @param pb   the parameter block.
+ * @param dce  the device control entry.
+ * @return     the result of the request.
+ */
+static OSErr vdisk_entry(short sel, ParmBlkPtr pb, DCtlPtr dce)
+{
+	short code;
+
+	switch (sel) {
+	case VDISK_PRIME:
+		return vdisk_prime((IOParam *) pb, dce);
+	case VDISK_CTL:
+		code = ((CntrlParam *) pb)->csCode;
+		if (code == VDISK_KILL_IO) {
+			return noErr;
+		} else if (code == VDISK_EJECT) {
+			/* finish up from vdisk_idle(), not from inside the driver */
+			ejected = true;
+			return noErr;
+		}
+		return controlErr;
+	case VDISK_STATUS:
+		return statusErr;
+	default:
+		return noErr;
+	}
+}
+
+/**
+ * Common code for the driver entry points. The Device Manager calls with the
+ * parameter block in A0 and the DCE in A1; the entry point has put which one it is
+ * in D0 and the application A5 in D1. Open, Close, KillIO and immediate calls return
+ * with RTS, everything else through IODone.
+ */
+static void vdisk_glue(void)
+{
+	asm {
+		move.l  a5, -(sp)
+		movea.l d1, a5
+		movem.l a0-a1, -(sp)
+		move.w  d0, -(sp)
+		move.l  a1, -(sp)
+		move.l  a0, -(sp)
+		move.w  d0, -(sp)
+		jsr     vdisk_entry
+		lea     10(sp), sp
+		move.w  (sp)+, d1
+		movem.l (sp)+, a0-a1
+		movea.l (sp)+, a5
+		unlk    a6               /* frame THINK C set up on entry */
+
+		cmpi.w  #VDISK_OPEN, d1
+		beq     @done
+		cmpi.w  #VDISK_CLOSE, d1
+		beq     @done
+		btst    #1, 6(a0)        /* noQueueBit of ioTrap */
+		bne     @done
+		cmpi.w  #VDISK_CTL, d1
+		bne     @iodone
+		cmpi.w  #VDISK_KILL_IO, 26(a0)
+		beq     @done
+	@iodone
+		move.l  0x08FC, -(sp)    /* JIODone */
+	@done
+		rts
+	}
+}
+
+/**
+ * Finds a drive number that is not in use.
+ */
+static short vdisk_free_drive(void)
+{
+	QHdrPtr qhp;
+	DrvQEl *qep;
+	short d;
+	Boolean used;
+
+	qhp = GetDrvQHdr();
+	for (d = 5; ; d++) {
+		used = false;
+		for (qep = (DrvQEl *) qhp->qHead; qep; qep = (DrvQEl *) qep->qLink) {
+			if (qep->dQDrive == d) {
+				used = true;
+				break;
+			}
+		}
+		if (! used) return d;
+	}
+}
+
+/**
+ * Takes the driver out of the system and releases its memory. The volume must
+ * already be unmounted.
+ */
+static void vdisk_remove(void)
+{
+	if (! mounted) return;
+
+	Dequeue((QElemPtr) qel, GetDrvQHdr());
+	vdisk_drvr_remove(~unit);
+	DisposPtr(qel - 4);
+	DisposPtr((Ptr) drvr);
+	DisposPtr(lines);
+	mounted = false;
+}
+
+/**
+ * Mounts a disk image from the file list as a read-only volume. Problems are
+ * reported to the user.
+ *
+ * @param scsi  the SCSI ID of the device.
+ * @param item  the item in the file list.
+ */
+void vdisk_mount(short scsi, short item)
+{
+	VDiskDriver d;
+	DCtlHandle dce;
+	HParamBlockRec pb;
+	unsigned char *flags;
+	long a5;
+	short i, err;
+
+	if (mounted) {
+		alert_template(0, ALRT_GENERIC, STRI_GA_VD_ONE);
+		return;
+	}
+
+	/* let the image code check for a volume and find where it starts */
+	if (! image_open(scsi, item)) return;
+	voff = image_hfs_offset();
+	image_close();
+	if (voff < 0) {
+		alert_template(0, ALRT_GENERIC, STRI_GA_VD_HFS);
+		return;
+	}
+	if (! emu_get_info(item, &findex, &fsize)) {
+		alert_template(0, ALRT_GENERIC, STRI_GA_NSF);
+		return;
+	}
+	window_get_item_name(item, fname);
+	scsi_id = scsi;
+
+	/* find a free unit table entry */
+	for (unit = VDISK_FIRST_UNIT; unit < VDISK_UNITS; unit++) {
+		if (! VDISK_UTABLE[unit]) break;
+	}
+	if (unit >= VDISK_UNITS) {
+		alert_template_error(0, ALRT_GENERIC, STRI_GA_VD_ERR, unitTblFullErr);
+		return;
+	}
+
+	if (! (lines = NewPtr(VDISK_LINES * VDISK_LINE_SIZE))) {
+		mem_fail();
+	}
+	for (i = 0; i < VDISK_LINES; i++) {
+		lblk[i] = -1;
+		lused[i] = 0;
+	}
+	ltick = 0;
+
+	/* build the driver */
+	d.flags = VDISK_FLAGS;
+	d.delay = 0;
+	d.emask = 0;
+	d.menu = 0;
+	BlockMove(VDISK_NAME, d.name, VDISK_NAME[0] + 1);
+	a5 = (long) SetCurrentA5();
+	for (i = 0; i < 5; i++) {
+		d.offset[i] = (short) ((char *) &(d.entry[i]) - (char *) &d);
+		d.entry[i].move_w = 0x303C;
+		d.entry[i].sel = i;
+		d.entry[i].move_l = 0x223C;
+		d.entry[i].a5 = a5;
+		d.entry[i].jmp = 0x4EF9;
+		d.entry[i].addr = (ProcPtr) vdisk_glue;
+	}
+	if (! (drvr = (VDiskDriver *) NewPtrSys(sizeof(VDiskDriver)))) {
+		mem_fail();
+	}
+	BlockMove(&d, drvr, sizeof(VDiskDriver));
+	flush_code();
+
+	/* the drive queue element has four bytes of flags before it */
+	if (! (qel = NewPtrSysClear(sizeof(DrvQEl) + 4))) {
+		mem_fail();
+	}
+	flags = (unsigned char *) qel;
+	flags[0] = VDISK_LOCKED;
+	flags[1] = VDISK_IN_PLACE;
+	qel += 4;
+
+	if (err = vdisk_drvr_install((Ptr) drvr, ~unit)) {
+		DisposPtr(qel - 4);
+		DisposPtr((Ptr) drvr);
+		DisposPtr(lines);
+		alert_template_error(0, ALRT_GENERIC, STRI_GA_VD_ERR, err);
+		return;
+	}
+	dce = VDISK_UTABLE[unit];
+	(**dce).dCtlDriver = (Ptr) drvr;
+	(**dce).dCtlFlags = VDISK_FLAGS | VDISK_OPENED;
+	(**dce).dCtlRefNum = ~unit;
+	(**dce).dCtlPosition = 0;
+
+	/* drive size in 512 byte blocks, split across two words */
+	drive = vdisk_free_drive();
+	((DrvQEl *) qel)->qType = 1;
+	((DrvQEl *) qel)->dQDrvSz = (short) ((fsize - voff) / 512);
+	((DrvQEl *) qel)->dQDrvSz2 = (short) (((fsize - voff) / 512) >> 16);
+	((DrvQEl *) qel)->dQFSID = 0;
+	AddDrive(~unit, drive, (DrvQElPtr) qel);
+	mounted = true;
+	ejected = false;
+	gone = false;
+
+	busy_cursor();
+	pb.volumeParam.ioCompletion = 0;
+	pb.volumeParam.ioNamePtr = 0;
+	pb.volumeParam.ioVRefNum = drive;
+	err = PBMountVol((ParmBlkPtr) &pb);
+	SetCursor(&arrow);
+	if (err) {
+		vdisk_remove();
+		alert_template_error(0, ALRT_GENERIC, STRI_GA_VD_ERR, err);
+	}
+}
+
+/**
+ * Unmounts the mounted image, if there is one, and removes the driver.
+ *
+ * Normally the driver is only removed once the File Manager no longer refers to
+ * it. When forced and files are still open, the volume is taken offline, and the
+ * driver is taken out of the unit table and drive queue regardless: the entry
+ * points are about to go away with the program, and a missing driver only gets an
+ * error from the Device Manager where stale code would crash.
+ *
+ * @param force  if true, the driver is removed even if the volume has files open,
+ *               for when the program is going away regardless.
+ * @return       true if nothing is mounted now, false if files are open.
+ */
+Boolean vdisk_unmount(Boolean force)
+{
+	HParamBlockRec pb;
+	short err;
+
+	if (! mounted) return true;
+
+	pb.volumeParam.ioCompletion = 0;
+	pb.volumeParam.ioNamePtr = 0;
+	pb.volumeParam.ioVRefNum = drive;
+	err = PBUnmountVol((ParmBlkPtr) &pb);
+	if (err == fBsyErr) {
+		if (! force) {
+			alert_template(ATYPE_CAUTION, ALRT_GENERIC, STRI_GA_CHNG_BSY);
+			return false;
+		}
+		PBOffLine((ParmBlkPtr) &pb);
+	} else if (err && err != nsvErr && ! force) {
+		/* still in use by the File Manager, the driver has to stay */
+		alert_template_error(0, ALRT_GENERIC, STRI_GA_VD_ERR, err);
+		return false;
+	}
+	vdisk_remove();
+	return true;
+}
+
+/**
+ * Called after a listing is loaded into the window to find the image again, as its
+ * file index may have changed. If it is no longer there with the same size, reads
+ * are refused from then on and the drive is marked as having no disk in it.
+ *
+ * @param scsi       the SCSI ID of the device the listing is from.
+ * @param open_type  zero for files, non-zero for images.
+ */
+void vdisk_relist(short scsi, short open_type)
+{
+	short item, index;
+	long size;
+
+	if (! mounted || gone || scsi != scsi_id || open_type) return;
+
+	if (emu_find(fname, &item) && emu_get_info(item, &index, &size) && size == fsize) {
+		findex = index;
+	} else {
+		gone = true;
+		qel[-3] = 0; /* no longer VDISK_IN_PLACE */
+	}
+}
+
+/**
+ * Called while the program is idle to remove the driver once the volume has been
+ * put away in the Finder.
+ */
+void vdisk_idle(void)
+{
+	HParamBlockRec pb;
+
+	if (! mounted) return;
+
+	pb.volumeParam.ioCompletion = 0;
+	pb.volumeParam.ioNamePtr = 0;
+	pb.volumeParam.ioVRefNum = drive;
+	pb.volumeParam.ioVolIndex = 0;
+	if (ejected) {
+		/* ejected but still known to the File Manager; finish the job */
+		PBUnmountVol((ParmBlkPtr) &pb);
+		ejected = false;
+	}
+	if (PBHGetVInfo(&pb, false) == nsvErr) {
+		vdisk_remove();
+	}
+}
@@ -0,0 +1,25 @@
+/*
+ * Copyright (C) 2026 saybur
+ *
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this
+ * program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __VDISKH__
+#define __VDISKH__
+
+void vdisk_mount(short scsi, short item);
+Boolean vdisk_unmount(Boolean force);
+void vdisk_idle(void);
+void vdisk_relist(short scsi, short open_type);
+
+#endif /* __VDISKH__ */
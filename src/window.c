@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2024 saybur
+ * Copyright (C) 2024-2026 saybur
  *
  * This program is free software: you can redistribute it and/or modify it under the
  * terms of the GNU General Public License as published by the Free Software
@@ -18,18 +18,82 @@
 #include "constants.h"
 #include "emu.h"
 #include "list.h"
+#include "peek.h"
+#include "prefetch.h"
 #include "window.h"
 #include "util.h"
 
 #define WINDOW_WIDTH        261
 #define WINDOW_HEADER       46
 
+/* width of the column on the right of the list with the file type */
+#define WINDOW_TYPE_WIDTH   36
+
+/* files to look at each time the program is idle */
+#define WINDOW_PEEK_COUNT   2
+
+/* 68000 JMP to an absolute address, to reach window_ldef() from a list */
+#define WINDOW_JMP          0x4EF9
+
+typedef struct {
+	short jmp;
+	ProcPtr addr;
+} LDEFStub;
+
 static WindowPtr window;
 static ListHandle list;
-static Handle icon_device, icon_files, icon_images;
+static Handle icon_device, icon_files, icon_images, ldef;
 static Str63 note;
 static Str15 str_device, str_files, str_images;
-static short content_type;
+static short content_type, content_scsi = -1;
+
+/**
+ * Draws a cell of the list: the name, as the standard LDEF would, and the file type
+ * on the right once peek.c has found it.
+ *
+ * This is reached through a JMP in a handle set as the list definition, rather than
+ * from an LDEF resource, so it can live in the application. Only drawing and
+ * highlighting are handled; the standard LDEF did the setup when the list was made.
+ */
+static pascal void window_ldef(short msg, Boolean sel, Rect *r, Cell cell,
+		short off, short len, ListHandle lh)
+{
+	Rect tr;
+	Handle cells;
+	char hs;
+	short size;
+	long type, creator;
+
+	if (msg == lHiliteMsg) {
+		InvertRect(r);
+		return;
+	}
+	if (msg != lDrawMsg) return;
+
+	EraseRect(r);
+	cells = (Handle) (**lh).cells;
+	hs = HGetState(cells);
+	HLock(cells);
+	MoveTo(r->left + (**lh).indent.h, r->top + (**lh).indent.v);
+	DrawText(*cells, off, len);
+	HSetState(cells, hs);
+
+	if (! content_type && peek_get(cell.v, &type, &creator)) {
+		/* names running under the type are cut off */
+		tr = *r;
+		tr.left = tr.right - WINDOW_TYPE_WIDTH;
+		EraseRect(&tr);
+		size = thePort->txSize;
+		TextSize(9);
+		MoveTo(tr.left + 4, r->top + (**lh).indent.v);
+		DrawText((Ptr) &type, 0, 4);
+		TextSize(size);
+	}
+
+	if (sel) {
+		InvertRect(r);
+	}
+}
 
 /**
  * Draws the window reminder/note text.
@@ -141,6 +205,7 @@ Boolean window_init(void)
 	short i;
 	Point p;
 	WStateData **wsd;
+	LDEFStub stub;
 
 	if (g_use_qdcolor) {
 		window = GetNewCWindow(WIND_MAIN, 0, (WindowPtr)-1);
@@ -172,6 +237,17 @@ Boolean window_init(void)
 	list = LNew(&list_vis, &list_con, list_cell, 0, window, true, true, false, true);
 	list_size(list, -1, -1);
 
+	stub.jmp = WINDOW_JMP;
+	stub.addr = (ProcPtr) window_ldef;
+	if (! (ldef = NewHandle(sizeof(LDEFStub)))) {
+		return false;
+	}
+	MoveHHi(ldef);
+	HLock(ldef);
+	BlockMove(&stub, *ldef, sizeof(LDEFStub));
+	flush_code();
+	(**list).listDefProc = ldef;
+
 	if (g_use_qdcolor) {
 		icon_device = (Handle) GetCIcon(ICON_DEVICE);
 		icon_files = (Handle) GetCIcon(ICON_FILES);
@@ -203,6 +279,27 @@ void window_activate(Boolean active)
 	list_draw_grow(window, list);
 }
 
+/**
+ * Tells prefetch.c which file is selected after the selection may have changed, so
+ * it can start reading the file ahead of a download. Only a single selected file
+ * counts; images and multiple selections clear it.
+ */
+static void window_selected(void)
+{
+	short i, j;
+
+	i = 0;
+	list_next(list, &i);
+	if (i >= 0 && ! content_type) {
+		j = i + 1;
+		list_next(list, &j);
+		if (j >= 0) i = -1;
+	} else {
+		i = -1;
+	}
+	prefetch_select(i);
+}
+
 /**
  * Handles /inContent/ on /mouseDown/.
  *
@@ -218,6 +315,7 @@ void window_click(EventRecord *evt, Boolean *dclick)
 	GlobalToLocal(&(evt->where));
 
 	*dclick = LClick(evt->where, evt->modifiers, list);
+	window_selected();
 
 	SetPort(old_port);
 }
@@ -250,6 +348,7 @@ void window_key(EventRecord *evt)
 {
 	/* delegate everything to the list */
 	list_key(list, evt);
+	window_selected();
 }
 
 /**
@@ -296,7 +395,9 @@ void window_next(short *i)
  * Sets the window contents to the given block of memory.
  *
  * Most of the heavy lifting is passed off to emu.c, but this still updates some internal
- * references to assist in drawing the window.
+ * references to assist in drawing the window. Loading the same device and mode again
+ * keeps the rows already shown, along with their selections, changing only those that
+ * differ; see emu_populate_list().
  *
  * The mode below defines how the window is drawn for the contents, where 0 is files, 1 is
  * images, and everything else is "no content."
@@ -310,6 +411,7 @@ void window_next(short *i)
 short window_populate(short scsi, short mode, Handle h, short len)
 {
 	short num;
+	Boolean keep;
 
 	if (scsi < 0) scsi = 0;
 	if (scsi > 6) scsi = 6;
@@ -317,8 +419,18 @@ short window_populate(short scsi, short mode, Handle h, short len)
 		str_device[str_device[0]] = '0' + scsi;
 	}
 
-	num = emu_populate_list(list, h, len);
+	/* a refresh of what is already shown only changes the rows that need it */
+	keep = (scsi == content_scsi && mode == content_type);
+	if (! keep) {
+		peek_clear();
+	}
 	content_type = mode;
+	content_scsi = scsi;
+	num = emu_populate_list(list, h, len, keep);
+
+	/* items may have moved, so look at the selection again */
+	prefetch_select(-1);
+	window_selected();
 	HLockHi((Handle) list);
 	if (mode == 0) {
 		(*list)->selFlags = lUseSense | lNoRect | lNoExtend;
@@ -330,6 +442,48 @@ short window_populate(short scsi, short mode, Handle h, short len)
 	return num;
 }
 
+/**
+ * Called while the program is idle to look at a few more of the files in view with
+ * peek.c, drawing each again with its type once found. Nothing is done for images.
+ * This stops early if the device reports UNIT ATTENTION, as the listing needs to
+ * be reloaded before anything more is read.
+ *
+ * @param scsi  the SCSI ID of the device.
+ * @param err   set to the UNIT ATTENTION error, or zero.
+ * @return      true if there are still files in view to look at, false otherwise.
+ */
+Boolean window_idle(short scsi, long *err)
+{
+	GrafPtr old_port;
+	Rect vis;
+	Cell c;
+	short n;
+
+	*err = 0;
+	if (content_type) return false;
+
+	GetPort(&old_port);
+	SetPort(window);
+
+	vis = (**list).visible;
+	if (vis.bottom > (**list).dataBounds.bottom) {
+		vis.bottom = (**list).dataBounds.bottom;
+	}
+	n = 0;
+	for (c.h = 0, c.v = vis.top; c.v < vis.bottom; c.v++) {
+		if (peek_done(c.v)) continue;
+		if (n++ >= WINDOW_PEEK_COUNT) break;
+		if (*err = peek_fetch(scsi, c.v)) {
+			n = 0;
+			break;
+		}
+		LDraw(c, list);
+	}
+
+	SetPort(old_port);
+	return n > WINDOW_PEEK_COUNT;
+}
+
 /**
  * Handles /osEvt/.
  *
@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2024 saybur
+ * Copyright (C) 2024-2026 saybur
  *
  * This program is free software: you can redistribute it and/or modify it under the
  * terms of the GNU General Public License as published by the Free Software
@@ -24,6 +24,7 @@ void window_key(EventRecord *evt);
 void window_next(short *i);
 void window_get_item_name(short item, Str255 str);
 short window_populate(short scsi, short mode, Handle h, short count);
+Boolean window_idle(short scsi, long *err);
 
 void window_activate(Boolean active);
 void window_grow(Point p);
@@ -0,0 +1,448 @@
+/*
+ * Copyright (C) 2026 saybur
+ *
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this
+ * program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "crc.h"
+#include "inflate.h"
+#include "types.h"
+#include "util.h"
+#include "zip.h"
+
+/*
+ * This compilation unit reads ZIP archives on the device. The end of central
+ * directory record is found at the end of the file, and it gives the central
+ * directory, which names every member of the archive along with its size and where
+ * its local header is. The central directory is scanned each time a folder is
+ * listed, so nothing about the archive is kept in memory; the image_read() block
+ * cache keeps the scan from going back to the device when it is small.
+ *
+ * ZIP archives do not have folders as such, only paths, so folders are made up from
+ * the paths of the members. A folder ID is the offset of a central directory record
+ * with a path inside the folder, shifted up to make room for how deep the folder is,
+ * which is enough to find the folder path again when it is listed.
+ *
+ * Members are extracted by reading only their compressed data, which is inflated as
+ * it arrives and written straight to the local file. Stored and deflated members are
+ * supported; other methods, encryption and ZIP64 are not.
+ *
+ * See the PKWARE APPNOTE.TXT for the structures used here.
+ */
+
+#define ZIP_SIG_EOCD      0x06054B50L
+#define ZIP_SIG_CENTRAL   0x02014B50L
+#define ZIP_SIG_LOCAL     0x04034B50L
+
+#define ZIP_EOCD_LEN      22
+#define ZIP_CENTRAL_LEN   46
+#define ZIP_LOCAL_LEN     30
+
+/* the end record may be followed by a comment of up to 64K */
+#define ZIP_MAX_COMMENT   65535L
+#define ZIP_SCAN_SIZE     4096L
+
+#define ZIP_STORED        0
+#define ZIP_DEFLATED      8
+#define ZIP_ENCRYPTED     0x0001
+
+/* paths longer than this are cut short */
+#define ZIP_MAX_PATH      255
+
+#define ZIP_COPY_SIZE     8192L
+
+static long base, cdoff, cdsize, count;
+static unsigned char path[ZIP_MAX_PATH + 1];
+static short plen;
+
+/* state of the member being extracted */
+static long zpos, zleft;
+static unsigned long zcrc;
+static Boolean zsniff;
+static ForkInfo *zinfo;
+
+/**
+ * Converts an MS-DOS date and time to Mac time.
+ *
+ * @param date  the date, with the year counted from 1980.
+ * @param time  the time, with seconds in twos.
+ * @return      seconds since 1904, or zero if the date is not set.
+ */
+static unsigned long zip_date(unsigned short date, unsigned short time)
+{
+	DateTimeRec dt;
+	unsigned long secs;
+
+	if (date == 0) return 0;
+	dt.year = 1980 + (date >> 9);
+	dt.month = (date >> 5) & 0x0F;
+	dt.day = date & 0x1F;
+	dt.hour = time >> 11;
+	dt.minute = (time >> 5) & 0x3F;
+	dt.second = (time & 0x1F) * 2;
+	dt.dayOfWeek = 0;
+	Date2Secs(&dt, &secs);
+	return secs;
+}
+
+/**
+ * Copies part of a path as a name, truncating to fit. Colons are not allowed in Mac
+ * names, so they are replaced.
+ *
+ * @param src  the start of the name.
+ * @param len  the length of the name.
+ * @param dst  set to the Pascal name.
+ */
+static void zip_name(unsigned char *src, short len, unsigned char *dst)
+{
+	if (len > 31) len = 31;
+	BlockMove(src, &(dst[1]), len);
+	dst[0] = len;
+	repl_chars(dst, ':', '-');
+}
+
+/**
+ * Reads a central directory record and its path.
+ *
+ * @param pos  the offset of the record within the central directory.
+ * @param rec  set to the fixed part of the record.
+ * @param len  set to the length of the path, which goes into the path buffer.
+ * @param next set to the offset of the following record.
+ * @return     zero on success, otherwise the error from reading.
+ */
+static long zip_record(long pos, unsigned char *rec, short *len, long *next)
+{
+	long err, nlen;
+
+	if (pos + ZIP_CENTRAL_LEN > cdsize) {
+		return IMAGE_BAD_DATA;
+	}
+	if (err = image_read(base + cdoff + pos, (char *) rec, ZIP_CENTRAL_LEN)) {
+		return err;
+	}
+	if (le32(rec) != ZIP_SIG_CENTRAL) {
+		return IMAGE_BAD_DATA;
+	}
+	nlen = le16(rec + 28);
+	*next = pos + ZIP_CENTRAL_LEN + nlen + le16(rec + 30) + le16(rec + 32);
+	if (nlen > ZIP_MAX_PATH) nlen = ZIP_MAX_PATH;
+	*len = (short) nlen;
+	return image_read(base + cdoff + pos + ZIP_CENTRAL_LEN, (char *) path, nlen);
+}
+
+/**
+ * Checks if the image is a ZIP archive by looking for the end of central directory
+ * record, first where it is when there is no archive comment and then back through
+ * the space a comment could take.
+ *
+ * @param voff  set to the offset of the end record, or -1 if there is not one.
+ * @return      zero on success, otherwise the error from reading.
+ */
+long zip_probe(long *voff)
+{
+	unsigned char *buf;
+	long fsize, pos, end, len, err;
+	short i;
+
+	*voff = -1;
+	fsize = image_size();
+	if (fsize < ZIP_EOCD_LEN) return 0;
+
+	if (! (buf = (unsigned char *) NewPtr(ZIP_SCAN_SIZE))) {
+		mem_fail();
+	}
+	err = 0;
+	end = fsize - ZIP_EOCD_LEN;
+	while (end >= 0 && end >= fsize - ZIP_EOCD_LEN - ZIP_MAX_COMMENT) {
+		/* each scan overlaps the last by the length of a signature */
+		len = ZIP_SCAN_SIZE - 3;
+		if (len > end + 1) len = end + 1;
+		pos = end - len + 1;
+		if (err = image_read(pos, (char *) buf, len + 3)) break;
+		for (i = (short) len - 1; i >= 0; i--) {
+			if (le32(buf + i) == ZIP_SIG_EOCD) {
+				*voff = pos + i;
+				break;
+			}
+		}
+		if (*voff >= 0) break;
+		end = pos - 1;
+	}
+	DisposPtr((Ptr) buf);
+	return err;
+}
+
+/**
+ * Reads the end of central directory record.
+ *
+ * @param voff  the offset of the end record, from zip_probe().
+ * @return      zero on success, otherwise the error from reading.
+ */
+long zip_load(long voff)
+{
+	unsigned char eocd[ZIP_EOCD_LEN];
+	long err;
+
+	if (err = image_read(voff, (char *) eocd, ZIP_EOCD_LEN)) {
+		return err;
+	}
+	count = le16(eocd + 10);
+	cdsize = le32(eocd + 12);
+	cdoff = le32(eocd + 16);
+
+	/* ZIP64 archives mark these as too large to hold */
+	if (count == 0xFFFF || cdsize == -1 || cdoff == -1) {
+		return IMAGE_BAD_DATA;
+	}
+
+	/* offsets are from the start of the archive, which may not be the file */
+	base = voff - cdsize - cdoff;
+	if (base < 0 || cdsize < 0) {
+		return IMAGE_BAD_DATA;
+	}
+
+	image_set_root(0);
+	return 0;
+}
+
+/**
+ * Lists a folder into the image entry table. Every member is looked at: those
+ * directly in the folder become files, and those further down give the folders
+ * inside it.
+ *
+ * @param dir  the folder ID.
+ * @return     zero on success, otherwise the error from reading.
+ */
+long zip_list(long dir)
+{
+	unsigned char rec[ZIP_CENTRAL_LEN];
+	unsigned char prefix[ZIP_MAX_PATH + 1];
+	ImageEntry e, f;
+	Str31 name;
+	long pos, next, n, i, err;
+	short depth, len, pre, start, p;
+	Boolean dup;
+
+	/* find the folder path again from the record it was made from */
+	depth = (short) (dir & 0xFF);
+	pre = 0;
+	start = 0;
+	name[0] = 0;
+	if (depth > 0) {
+		if (err = zip_record(dir >> 8, rec, &len, &next)) {
+			image_set_dir(dir, 0, name);
+			return err;
+		}
+		for (p = 0; p < len && depth > 0; p++) {
+			if (path[p] == '/') {
+				if (--depth > 0) start = p + 1;
+			}
+		}
+		pre = p;
+		BlockMove(path, prefix, pre);
+		zip_name(prefix + start, pre - start - 1, name);
+	}
+	depth = (short) (dir & 0xFF);
+
+	err = 0;
+	pos = 0;
+	for (n = 0; n < count; n++, pos = next) {
+		if (err = zip_record(pos, rec, &len, &next)) break;
+		if (len <= pre) continue;
+		for (p = 0; p < pre && path[p] == prefix[p]; p++) ;
+		if (p < pre) continue;
+
+		/* anything below this folder shows as the folder it is in */
+		for (p = pre; p < len && path[p] != '/'; p++) ;
+		if (p == pre) continue;
+		zip_name(path + pre, p - pre, e.name);
+		e.parent = dir;
+		e.folder = (p < len);
+		e.type = 0;
+		e.creator = 0;
+		e.flags = 0;
+		e.crdate = zip_date(le16(rec + 14), le16(rec + 12));
+		e.mddate = e.crdate;
+		e.rlen = 0;
+		e.start[FORK_RSRC] = 0;
+
+		if (e.folder) {
+			if (depth >= 0xFF) continue;
+			dup = false;
+			for (i = 0; i < image_count() && ! dup; i++) {
+				image_get(i, &f);
+				dup = f.folder && EqualString(f.name, e.name, true, true);
+			}
+			if (dup) continue;
+			e.id = (pos << 8) | (depth + 1);
+			e.dlen = 0;
+			e.start[FORK_DATA] = 0;
+			e.csize = 0;
+			e.method = 0;
+			e.crc = 0;
+		} else {
+			e.id = pos;
+			e.dlen = le32(rec + 24);
+			e.start[FORK_DATA] = le32(rec + 42);
+			e.csize = le32(rec + 20);
+			e.method = le16(rec + 10);
+			if (le16(rec + 8) & ZIP_ENCRYPTED) e.method = -1;
+			e.crc = (unsigned long) le32(rec + 16);
+		}
+
+		if (! image_add(&e)) {
+			/* table is full, show what fit */
+			break;
+		}
+	}
+
+	/* the parent is the same record, one folder less deep */
+	image_set_dir(dir, (depth > 1 ? (dir & ~0xFFL) | (depth - 1) : 0), name);
+	return err;
+}
+
+/**
+ * Works out where in the image the compressed data of a member is.
+ *
+ * @param e       the member.
+ * @param fork    FORK_DATA; members do not have resource forks.
+ * @param pos     the offset within the compressed data.
+ * @param offset  set to the offset within the image.
+ * @param run     set to how many bytes are contiguous from there.
+ * @return        zero on success, otherwise the error from reading.
+ */
+long zip_map(ImageEntry *e, short fork, long pos, long *offset, long *run)
+{
+	unsigned char loc[ZIP_LOCAL_LEN];
+	long err;
+
+	if (fork != FORK_DATA || pos < 0 || pos >= e->csize) {
+		return IMAGE_BAD_DATA;
+	}
+	if (err = image_read(base + e->start[FORK_DATA], (char *) loc, ZIP_LOCAL_LEN)) {
+		return err;
+	}
+	if (le32(loc) != ZIP_SIG_LOCAL) {
+		return IMAGE_BAD_DATA;
+	}
+
+	/* the local header has its own copy of the path and extra field */
+	*offset = base + e->start[FORK_DATA] + ZIP_LOCAL_LEN
+			+ le16(loc + 26) + le16(loc + 28) + pos;
+	*run = e->csize - pos;
+	return 0;
+}
+
+/**
+ * Supplies compressed data to the inflate code.
+ */
+static long zip_in(unsigned char *buf, long *len)
+{
+	long err;
+
+	if (*len > zleft) *len = zleft;
+	if (err = image_read(zpos, (char *) buf, *len)) {
+		return err;
+	}
+	zpos += *len;
+	zleft -= *len;
+	return 0;
+}
+
+/**
+ * Writes out data from the member, checking it against the CRC as it goes. The
+ * first part is used to guess a type, as ZIP archives do not keep Finder info.
+ */
+static long zip_out(unsigned char *buf, long len)
+{
+	char head[512];
+	short i, ferr;
+
+	if (zsniff) {
+		for (i = 0; i < 512; i++) {
+			head[i] = (i < len ? buf[i] : 0);
+		}
+		types_find(head, zinfo->name, &(zinfo->type), &(zinfo->creator));
+		fork_set_info(zinfo);
+		zsniff = false;
+	}
+
+	zcrc = crc32_update(zcrc, buf, len);
+	if (ferr = fork_write(FORK_DATA, (char *) buf, len)) {
+		/* file errors are told apart by being negative */
+		return ferr;
+	}
+	return 0;
+}
+
+/**
+ * Extracts a member into the open data fork, inflating it if needed. Only the
+ * compressed data of the member is read from the device.
+ *
+ * @param e     the member.
+ * @param info  the info the local file was created with; the type and creator are
+ *              set from the contents if they are zero.
+ * @param ferr  set to the OSErr if writing the local file fails.
+ * @return      zero on success, IMAGE_UNSUPPORTED if the member is compressed in a
+ *              way that cannot be decoded, IMAGE_BAD_CRC if it does not match its
+ *              CRC, otherwise the error from reading.
+ */
+long zip_extract(ImageEntry *e, ForkInfo *info, short *ferr)
+{
+	unsigned char *buf;
+	long err, run, len;
+
+	*ferr = 0;
+	if (e->method != ZIP_STORED && e->method != ZIP_DEFLATED) {
+		return IMAGE_UNSUPPORTED;
+	}
+
+	zpos = 0;
+	zleft = e->csize;
+	zcrc = 0;
+	zinfo = info;
+	zsniff = (info->type == 0);
+	if (e->csize > 0 && (err = zip_map(e, FORK_DATA, 0, &zpos, &run))) {
+		return err;
+	}
+
+	if (e->method == ZIP_DEFLATED) {
+		err = inflate_run(zip_in, zip_out);
+	} else {
+		if (! (buf = (unsigned char *) NewPtr(ZIP_COPY_SIZE))) {
+			mem_fail();
+		}
+		err = 0;
+		while (zleft > 0 && ! err) {
+			len = ZIP_COPY_SIZE;
+			if (! (err = zip_in(buf, &len))) {
+				err = zip_out(buf, len);
+			}
+		}
+		DisposPtr((Ptr) buf);
+	}
+
+	/* an empty member still needs a type */
+	if (! err && zsniff) {
+		err = zip_out((unsigned char *) "", 0);
+	}
+
+	if (err < 0) {
+		*ferr = (short) err;
+		return 0;
+	}
+	if (! err && zcrc != e->crc) {
+		return IMAGE_BAD_CRC;
+	}
+	return err;
+}